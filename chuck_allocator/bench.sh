@@ -0,0 +1,11 @@
+#!/bin/bash
+
+# Usage: bench.sh [--max-nodes N] [--threads T] [--filter NAME] [--chunk-size BYTES]
+#                 [--source new|mmap|mmap_populate|huge|huge_populate]
+
+set -e
+
+g++ -std=c++17 -O2 -pthread -I./ bench/chunk_bench.cpp -o chunk_bench
+./chunk_bench "$@"
+
+rm chunk_bench
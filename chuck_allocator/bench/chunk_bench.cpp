@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "chunk_allocator.h"
+
+
+// Keeps the optimizer from discarding a result.
+template <class T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+struct Options {
+    size_t max_nodes = 1 << 22;
+    size_t threads = 1;
+    std::string filter;
+    // Passed to every ChunkAllocator.
+    size_t chunk_size = 0;
+    ChunkSource* source = nullptr;
+};
+
+ChunkOptions ArenaOptions(const Options& options, ChunkFallback fallback = ChunkFallback::new_chunk,
+                          ChunkRecycling recycling = ChunkRecycling::off) {
+    return { options.chunk_size, fallback, recycling, options.source };
+}
+
+// Null for the default source, or for an unknown name.
+ChunkSource* SourceByName(const std::string& name) {
+    static MmapChunkSource mmap_source(false), populated_source(true);
+    static HugePageChunkSource huge_source(false), populated_huge_source(true);
+
+    if (name == "mmap") {
+        return &mmap_source;
+    } else if (name == "mmap_populate") {
+        return &populated_source;
+    } else if (name == "huge") {
+        return &huge_source;
+    } else if (name == "huge_populate") {
+        return &populated_huge_source;
+    }
+    return nullptr;
+}
+
+// Nanoseconds per allocation over all n allocations, and over the last
+// quarter of them, which is where a cost growing with the arena shows.
+struct Result {
+    double ns_per_op;
+    double tail_ns_per_op;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double Nanoseconds(Clock::time_point begin, Clock::time_point end) {
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+// Every thread appends n / threads nodes to its own list; all lists share
+// one allocator.
+template <class Allocator>
+Result BuildLists(const Allocator& allocator, size_t n, size_t threads) {
+    std::vector<double> total(threads), tail(threads);
+    std::vector<std::thread> workers;
+
+    for (size_t t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::list<int, Allocator> list(allocator);
+            size_t count = n / threads;
+            size_t tail_begin = count - count / 4;
+
+            auto begin = Clock::now();
+            for (size_t i = 0; i < tail_begin; ++i) {
+                list.push_back(i);
+            }
+            auto middle = Clock::now();
+            for (size_t i = tail_begin; i < count; ++i) {
+                list.push_back(i);
+            }
+            auto end = Clock::now();
+
+            DoNotOptimize(list.back());
+            total[t] = Nanoseconds(begin, end) / count;
+            tail[t] = Nanoseconds(middle, end) / (count - tail_begin);
+        });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    return { *std::max_element(total.begin(), total.end()), *std::max_element(tail.begin(), tail.end()) };
+}
+
+// Blocks of 8 to 256 bytes in a fixed pseudo-random order, so that chunks
+// are left with unused space for best fit to find.
+Result MixedSizes(ChunkAllocator<char> allocator, size_t n) {
+    size_t tail_begin = n - n / 4;
+    unsigned state = 1;
+
+    auto allocate = [&]() {
+        state = state * 1103515245u + 12345u;
+        size_t size = 8 + (state >> 16) % 249;
+        char* block = allocator.allocate(size);
+        block[0] = 1;
+    };
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < tail_begin; ++i) {
+        allocate();
+    }
+    auto middle = Clock::now();
+    for (size_t i = tail_begin; i < n; ++i) {
+        allocate();
+    }
+    auto end = Clock::now();
+
+    return { Nanoseconds(begin, end) / n, Nanoseconds(middle, end) / (n - tail_begin) };
+}
+
+// n inserts into a map of at most 1024 keys, each followed by erasing the
+// oldest key, so that a recycling allocator serves every insert after the
+// first few from freed nodes.
+template <class Allocator>
+Result ChurnMap(const Allocator& allocator, size_t n) {
+    const size_t live = 1024;
+    size_t tail_begin = n - n / 4;
+    std::map<size_t, size_t, std::less<size_t>, Allocator> map(allocator);
+
+    auto step = [&](size_t i) {
+        map.emplace(i, i);
+        if (i >= live) {
+            map.erase(i - live);
+        }
+    };
+
+    auto begin = Clock::now();
+    for (size_t i = 0; i < tail_begin; ++i) {
+        step(i);
+    }
+    auto middle = Clock::now();
+    for (size_t i = tail_begin; i < n; ++i) {
+        step(i);
+    }
+    auto end = Clock::now();
+
+    DoNotOptimize(map.size());
+    return { Nanoseconds(begin, end) / n, Nanoseconds(middle, end) / (n - tail_begin) };
+}
+
+struct Case {
+    std::string name;
+    std::function<Result(size_t n, const Options& options)> run;
+};
+
+std::vector<Case> Cases() {
+    return {
+        { "list_std", [](size_t n, const Options& options) {
+            return BuildLists(std::allocator<int>(), n, options.threads);
+        } },
+        { "list_chunk", [](size_t n, const Options& options) {
+            return BuildLists(ChunkAllocator<int>(ArenaOptions(options)), n, options.threads);
+        } },
+        { "list_best_fit", [](size_t n, const Options& options) {
+            return BuildLists(ChunkAllocator<int>(ArenaOptions(options, ChunkFallback::best_fit)), n, options.threads);
+        } },
+        { "mixed_chunk", [](size_t n, const Options& options) {
+            return MixedSizes(ChunkAllocator<char>(ArenaOptions(options)), n);
+        } },
+        { "churn_std", [](size_t n, const Options&) {
+            return ChurnMap(std::allocator<std::pair<const size_t, size_t>>(), n);
+        } },
+        { "churn_recycling", [](size_t n, const Options& options) {
+            ChunkOptions arena = ArenaOptions(options, ChunkFallback::new_chunk, ChunkRecycling::size_classes);
+            return ChurnMap(ChunkAllocator<std::pair<const size_t, size_t>>(arena), n);
+        } },
+        { "mixed_best_fit", [](size_t n, const Options& options) {
+            return MixedSizes(ChunkAllocator<char>(ArenaOptions(options, ChunkFallback::best_fit)), n);
+        } },
+    };
+}
+
+
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--max-nodes" && has_value) {
+            options.max_nodes = std::stoul(argv[++i]);
+        } else if (arg == "--threads" && has_value) {
+            options.threads = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--chunk-size" && has_value) {
+            options.chunk_size = std::stoul(argv[++i]);
+        } else if (arg == "--source" && has_value) {
+            std::string name = argv[++i];
+            options.source = SourceByName(name);
+            if (!options.source && name != "new") {
+                std::cerr << "Unknown source " << name << "\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown argument " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(16) << "benchmark" << std::right
+              << std::setw(10) << "n" << std::setw(12) << "ns/op" << std::setw(14) << "tail ns/op" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const Case& bench : Cases()) {
+        if (bench.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        for (size_t n = 1 << 10; n <= options.max_nodes; n *= 4) {
+            // The first run also pays for faulting in fresh pages.
+            bench.run(n, options);
+            Result result = bench.run(n, options);
+
+            std::cout << std::left << std::setw(16) << bench.name << std::right
+                      << std::setw(10) << n << std::setw(12) << result.ns_per_op
+                      << std::setw(14) << result.tail_ns_per_op << "\n";
+        }
+    }
+}
@@ -1,137 +1,654 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <new>
+#include <utility>
 
-template <typename T>
-class ChunkAllocator {
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Where ChunkArena gets its chunks from and returns them to. Sources are
+// not owned by the arenas using them and must outlive them; allocate() and
+// deallocate() may be called from any thread.
+class ChunkSource {
 public:
-    using value_type = T;
-    using pointer = T*;
-    using const_pointer = const T*;
-    using reference = T&;
-    using const_reference = const T&;
-    using size_type = std::size_t;
-    using difference_type = std::ptrdiff_t;
-    template <class U> struct rebind { typedef ChunkAllocator<U> other; };
+    virtual ~ChunkSource() = default;
 
-    static const size_type chunk_n = 1024u;
+    // At least ChunkArena::alignment aligned; throws std::bad_alloc on failure.
+    virtual void* allocate(std::size_t bytes) = 0;
+    virtual void deallocate(void* ptr, std::size_t bytes) = 0;
 
-    ChunkAllocator() {
-        head = new Chunk(chunk_n);
-        copy_counter = new size_type(1);
+    // Memory comes in multiples of this many bytes, so arenas round their
+    // chunks up to it instead of wasting the rest.
+    virtual std::size_t granularity() const {
+        return 1;
     }
+};
 
-    ChunkAllocator(const ChunkAllocator& other) {
-        this->head = other.head;
-        this->copy_counter = other.copy_counter;
+// The general-purpose heap, through aligned operator new; the default.
+class NewChunkSource : public ChunkSource {
+public:
+    static NewChunkSource* instance() {
+        static NewChunkSource source;
+        return &source;
+    }
 
-        ++(*this->copy_counter);
+    void* allocate(std::size_t bytes) override {
+        return ::operator new(bytes, std::align_val_t(64));
     }
 
-    ChunkAllocator& operator=(const ChunkAllocator& other) {
-        if (this == &other) {
-            return *this;
+    void deallocate(void* ptr, std::size_t) override {
+        ::operator delete(ptr, std::align_val_t(64));
+    }
+};
+
+// Anonymous private mappings, so every chunk is its own page-aligned slab
+// going straight back to the kernel. With `populate` the pages are faulted
+// in by mmap itself (MAP_POPULATE, where available) instead of on first touch.
+class MmapChunkSource : public ChunkSource {
+public:
+    explicit MmapChunkSource(bool populate = false) : populate(populate) {}
+
+    void* allocate(std::size_t bytes) override {
+        return map(bytes, populate);
+    }
+
+    void deallocate(void* ptr, std::size_t bytes) override {
+        munmap(ptr, bytes);
+    }
+
+    std::size_t granularity() const override {
+        static const std::size_t page_size = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+        return page_size;
+    }
+
+protected:
+    static void* map(std::size_t bytes, bool populate) {
+        int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_POPULATE
+        if (populate) {
+            flags |= MAP_POPULATE;
+        }
+#endif
+
+        void* ptr = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (ptr == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+
+        return ptr;
+    }
+
+    const bool populate;
+};
+
+// Mappings aligned to and sized in whole huge pages and marked with
+// madvise(MADV_HUGEPAGE), so that transparent huge pages back them and
+// large arenas take fewer TLB misses. Only a hint: where THP is disabled, or
+// MADV_HUGEPAGE does not exist, this behaves like MmapChunkSource.
+class HugePageChunkSource : public MmapChunkSource {
+public:
+    static const std::size_t huge_page_size = std::size_t(2) << 20;
+
+    explicit HugePageChunkSource(bool populate = false) : MmapChunkSource(populate) {}
+
+    // Maps a huge page more than needed and unmaps the misaligned ends. Pages
+    // are populated only after the advice, so that they can be huge ones.
+    void* allocate(std::size_t bytes) override {
+        unsigned char* mapping = static_cast<unsigned char*>(map(bytes + huge_page_size, false));
+        std::size_t address = reinterpret_cast<std::size_t>(mapping);
+        std::size_t head = (huge_page_size - address % huge_page_size) % huge_page_size;
+
+        if (head) {
+            munmap(mapping, head);
         }
+        munmap(mapping + head + bytes, huge_page_size - head);
 
-        if (*copy_counter == 1) {
-            while (head) {
-                Chunk* to_delete = head;
-                head = head->next;
-                delete to_delete;
+        void* ptr = mapping + head;
+#ifdef MADV_HUGEPAGE
+        madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+
+        if (populate) {
+#ifdef MADV_POPULATE_WRITE
+            if (madvise(ptr, bytes, MADV_POPULATE_WRITE) == 0) {
+                return ptr;
+            }
+#endif
+            for (std::size_t offset = 0; offset < bytes; offset += MmapChunkSource::granularity()) {
+                static_cast<volatile unsigned char*>(ptr)[offset] = 0;
             }
+        }
+
+        return ptr;
+    }
+
+    std::size_t granularity() const override {
+        return huge_page_size;
+    }
+};
+
+
+// What ChunkArena does when a block does not fit in the current chunk of
+// the thread.
+enum class ChunkFallback {
+    // Start a new chunk, unless a thread that stopped using the arena left a
+    // chunk with room behind; allocation never looks at other older chunks.
+    new_chunk,
+    // Give the full chunk up if it has at least `alignment` bytes left, and
+    // adopt the released chunk with the least free space that still fits the
+    // block, starting a new chunk only if there is none. Released chunks are
+    // kept by free space rounded down to a power of two, so the search is
+    // O(1) and what it finds is at most twice the best fit. Wastes less
+    // memory on mixed sizes.
+    best_fit,
+};
 
-            delete copy_counter;
-        } else {
-            copy_counter--;
+// Whether ChunkArena hands freed blocks out again.
+enum class ChunkRecycling {
+    // deallocate() does nothing; memory comes back only with the arena.
+    off,
+    // Blocks of up to ChunkArena::max_recycled bytes, with an alignment of at
+    // most ChunkArena::granule, are rounded up to a multiple of the granule,
+    // and freed ones are kept on a free list per size, stored in the blocks
+    // themselves, for later allocations of the same size class. A thread
+    // takes a whole list at a time and gives what it has not used back
+    // along with its chunk. Fresh memory still comes from the bump path.
+    size_classes,
+};
+
+struct ChunkOptions {
+    // Bytes per chunk, rounded up to the granularity of the source; zero
+    // makes ChunkAllocator<T> use chunk_n elements of T. No block can be
+    // larger than this.
+    std::size_t chunk_size = 0;
+    ChunkFallback fallback = ChunkFallback::new_chunk;
+    ChunkRecycling recycling = ChunkRecycling::off;
+    // Null means NewChunkSource::instance().
+    ChunkSource* source = nullptr;
+};
+
+// Memory shared by a ChunkAllocator and all of its copies, rebound ones
+// included. Every thread bumps from a current chunk of its own, found
+// through a small thread-local cache, so allocation is O(1) and takes no
+// lock; the shared chunk list is only touched, with a CAS, to push a new
+// chunk, and released chunks change hands under a mutex. A thread gives its
+// chunk back when the arena is evicted from its cache and when the thread
+// exits, and takes one of those over before starting a new chunk. All
+// chunks are freed together with the arena, once the last allocator
+// referencing it is destroyed.
+class ChunkArena {
+public:
+    // Chunks, and therefore all blocks, are aligned to this.
+    static const std::size_t alignment = 64;
+
+    // Size classes under ChunkRecycling::size_classes.
+    static const std::size_t granule = 16;
+    static const std::size_t max_recycled = 1024;
+    static const std::size_t class_count = max_recycled / granule;
+
+    explicit ChunkArena(const ChunkOptions& options) :
+            chunk_bytes(options.chunk_size),
+            fallback_policy(options.fallback),
+            recycling_policy(options.recycling),
+            source(options.source ? options.source : NewChunkSource::instance()),
+            chunk_total(round_up(Chunk::header + chunk_bytes, source->granularity())),
+            control(new Control(this)), references(1), head(nullptr), released_classes(0), released(),
+            free_lists() {}
+
+    ChunkArena(const ChunkArena&) = delete;
+    ChunkArena& operator=(const ChunkArena&) = delete;
+
+    ~ChunkArena() {
+        // Caches still holding entries for this arena find it gone from now on.
+        {
+            std::lock_guard<std::mutex> guard(control->lock);
+            control->arena = nullptr;
         }
+        Control::unreference(control);
 
-        *this = ChunkAllocator(other);
-        return *this;
+        Chunk* chunk = head.load(std::memory_order_acquire);
+        while (chunk) {
+            Chunk* next = chunk->next;
+            source->deallocate(chunk, chunk_total);
+            chunk = next;
+        }
     }
 
-    pointer allocate(const size_type n) {
-        if (n > chunk_n) {
+    void acquire() {
+        references.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // True if this was the last reference and the arena must be deleted.
+    bool release() {
+        return references.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    std::size_t chunk_size() const {
+        return chunk_bytes;
+    }
+
+    ChunkFallback fallback() const {
+        return fallback_policy;
+    }
+
+    ChunkRecycling recycling() const {
+        return recycling_policy;
+    }
+
+    // Throws std::bad_alloc if the block cannot fit in a chunk.
+    void* allocate(std::size_t bytes, std::size_t align) {
+        if (bytes > chunk_bytes || align > alignment) {
             throw std::bad_alloc();
         }
 
-        Chunk* chunk = head;
+        CacheEntry& entry = cache_entry();
+
+        if (recyclable(bytes, align)) {
+            std::size_t index = size_class(bytes);
+            FreeBlock*& local = entry.free_lists[index];
 
-        while (chunk->next) {
-            if (chunk->can_allocate(n)) {
-                return chunk->allocate(n);
-            } else {
-                chunk = chunk->next;
+            // Take everything freed into this class since the last time at
+            // once, so that popping needs no synchronization.
+            if (!local) {
+                local = free_lists[index].exchange(nullptr, std::memory_order_acquire);
             }
+            if (local) {
+                FreeBlock* block = local;
+                local = block->next;
+                return block;
+            }
+
+            bytes = (index + 1) * granule;
+            align = granule;
         }
 
-        if (chunk->can_allocate(n)) {
-            return chunk->allocate(n);
-        } else {
-            Chunk* new_chunk = new Chunk(n);
-            chunk->next = new_chunk;
+        if (entry.chunk) {
+            if (void* block = entry.chunk->bump(bytes, align)) {
+                return block;
+            }
+
+        }
 
-            return new_chunk->allocate(n);
+        Chunk* chunk = nullptr;
+        bool giving_back = entry.chunk && fallback_policy == ChunkFallback::best_fit;
+        if (giving_back || released_classes.load(std::memory_order_relaxed) != 0) {
+            std::lock_guard<std::mutex> guard(control->lock);
+            if (giving_back) {
+                give_back(entry.chunk);
+            }
+            chunk = adopt(bytes, align);
+        }
+        if (!chunk) {
+            chunk = new_chunk();
         }
+        entry.chunk = chunk;
+
+        return chunk->bump(bytes, align);
     }
 
-    void deallocate(pointer ptr, const size_type n) {}
+    // Puts the block on the free list of its size class when recycling, so
+    // `bytes` and `align` must be those it was allocated with.
+    void deallocate(void* ptr, std::size_t bytes, std::size_t align) {
+        if (!ptr || !recyclable(bytes, align)) {
+            return;
+        }
 
-    template <typename ... Args>
-    void construct(pointer p, const Args&&... args) {
-        return new (p) T(std::forward<Args>(args)...);
+        std::atomic<FreeBlock*>& list = free_lists[size_class(bytes)];
+        FreeBlock* block = new (ptr) FreeBlock{ list.load(std::memory_order_relaxed) };
+        while (!list.compare_exchange_weak(block->next, block, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
     }
 
-    void destroy(pointer p) {
-        p->~T();
+private:
+    // A freed block, linked through its first bytes.
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Header at the start of every chunk, padded to `alignment`, followed by
+    // `size` bytes of which the first `used` are handed out. Only the thread
+    // that owns a chunk bumps from it; a released chunk may be adopted by
+    // any thread, which takes over the rest of it. Released chunks are
+    // linked through `next_released`, under the control lock.
+    struct Chunk {
+        Chunk* next;
+        std::size_t size;
+        std::size_t used;
+        Chunk* next_released;
+
+        static const std::size_t header = (2 * sizeof(Chunk*) + 2 * sizeof(std::size_t) + alignment - 1) /
+                                          alignment * alignment;
+
+        Chunk(Chunk* next, std::size_t size) : next(next), size(size), used(0), next_released(nullptr) {}
+
+        unsigned char* data() {
+            return reinterpret_cast<unsigned char*>(this) + header;
+        }
+
+        std::size_t offset(std::size_t align) const {
+            return (used + align - 1) / align * align;
+        }
+
+        std::size_t space() const {
+            return size - used;
+        }
+
+        // Owner only; null if the block does not fit.
+        void* bump(std::size_t bytes, std::size_t align) {
+            std::size_t start = offset(align);
+            if (start + bytes > size) {
+                return nullptr;
+            }
+
+            used = start + bytes;
+            return data() + start;
+        }
+    };
+
+    // Outlives the arena for as long as thread caches refer to it, so that
+    // a cache can tell under the lock whether its arena still exists before
+    // handing anything back. The lock also guards the released chunks.
+    // Deleted with the last reference.
+    struct Control {
+        std::mutex lock;
+        // Null once the arena is destroyed.
+        ChunkArena* arena;
+        // The arena and every cache entry of it.
+        std::atomic<std::size_t> references;
+
+        explicit Control(ChunkArena* arena) : arena(arena), references(1) {}
+
+        static void unreference(Control* control) {
+            if (control->references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                delete control;
+            }
+        }
+    };
+
+    // The current chunk of a thread in each of the last few arenas it used,
+    // with the free blocks it has taken from the shared lists.
+    struct CacheEntry {
+        Control* control;
+        Chunk* chunk;
+        FreeBlock* free_lists[class_count];
+    };
+
+    static const std::size_t cache_size = 8;
+
+    struct Cache {
+        CacheEntry entries[cache_size];
+        std::size_t next_victim;
+
+        ~Cache() {
+            for (CacheEntry& entry : entries) {
+                leave(entry);
+            }
+        }
+    };
+
+    static Cache& thread_cache() {
+        static thread_local Cache cache = {};
+        return cache;
     }
 
-    ~ChunkAllocator() {
-        if (*copy_counter == 1) {
-            while (head) {
-                Chunk* to_delete = head;
-                head = head->next;
-                delete to_delete;
+    // The entry of this arena in the cache of the calling thread, evicting
+    // the oldest one if there is none.
+    CacheEntry& cache_entry() {
+        Cache& cache = thread_cache();
+        for (CacheEntry& entry : cache.entries) {
+            if (entry.control == control) {
+                return entry;
             }
+        }
+
+        CacheEntry& entry = cache.entries[cache.next_victim++ % cache_size];
+        leave(entry);
+        control->references.fetch_add(1, std::memory_order_relaxed);
+        entry.control = control;
+
+        return entry;
+    }
 
-            delete copy_counter;
-        } else {
-            copy_counter--;
+    // Hands the chunk and the free blocks of an entry back to its arena, if
+    // that still exists, and empties the entry.
+    static void leave(CacheEntry& entry) {
+        if (!entry.control) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> guard(entry.control->lock);
+            if (ChunkArena* arena = entry.control->arena) {
+                if (entry.chunk) {
+                    arena->give_back(entry.chunk);
+                }
+                for (std::size_t index = 0; index < class_count; ++index) {
+                    if (entry.free_lists[index]) {
+                        arena->give_back(index, entry.free_lists[index]);
+                    }
+                }
+            }
         }
+
+        Control::unreference(entry.control);
+        entry = CacheEntry();
     }
 
-private:
-    class Chunk {
-    public:
-        friend ChunkAllocator<value_type>;
+    bool recyclable(std::size_t bytes, std::size_t align) const {
+        return recycling_policy == ChunkRecycling::size_classes && bytes <= max_recycled &&
+               align <= granule && (size_class(bytes) + 1) * granule <= chunk_bytes;
+    }
+
+    static std::size_t size_class(std::size_t bytes) {
+        return bytes == 0 ? 0 : (bytes - 1) / granule;
+    }
+
+    static std::size_t round_up(std::size_t value, std::size_t multiple) {
+        return (value + multiple - 1) / multiple * multiple;
+    }
+
+    Chunk* new_chunk() {
+        void* memory = source->allocate(chunk_total);
+        Chunk* chunk = new (memory) Chunk(head.load(std::memory_order_relaxed), chunk_total - Chunk::header);
 
-        Chunk(size_t n) {
-            this->data = (pointer)(new uint8_t(n * sizeof(value_type)));
-            this->free = this->data;
-            free_size = n;
+        while (!head.compare_exchange_weak(chunk->next, chunk, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+
+        return chunk;
+    }
+
+    static std::size_t floor_log2(std::size_t value) {
+        std::size_t result = 0;
+        while (value >>= 1) {
+            ++result;
         }
+        return result;
+    }
 
-        bool can_allocate(size_t n) const {
-            return n <= free_size;
+    // Releases a chunk its owner is done with, if there is enough left in it
+    // to be worth adopting, into the class of its free space. Control lock held.
+    void give_back(Chunk* chunk) {
+        std::size_t space = chunk->space();
+        if (space < alignment) {
+            return;
         }
 
-        pointer allocate(size_type n) {
-            pointer result = free;
+        std::size_t index = floor_log2(space);
+        chunk->next_released = released[index];
+        released[index] = chunk;
+        released_classes.fetch_or(std::uint64_t(1) << index, std::memory_order_relaxed);
+    }
+
+    // Puts a list of free blocks back on the shared list of its class. Only
+    // a list that others have pushed to since it was taken is walked to
+    // find its end.
+    void give_back(std::size_t index, FreeBlock* first) {
+        std::atomic<FreeBlock*>& list = free_lists[index];
+        FreeBlock* next = nullptr;
+        if (list.compare_exchange_strong(next, first, std::memory_order_release, std::memory_order_relaxed)) {
+            return;
+        }
+
+        FreeBlock* last = first;
+        while (last->next) {
+            last = last->next;
+        }
+
+        last->next = next;
+        while (!list.compare_exchange_weak(last->next, first, std::memory_order_release,
+                                           std::memory_order_relaxed)) {}
+    }
+
+    // A released chunk that fits the block, or null. Every chunk in the
+    // classes above that of the worst-case size fits, so only the first one
+    // of that class itself needs checking. Control lock held.
+    Chunk* adopt(std::size_t bytes, std::size_t align) {
+        std::size_t needed = bytes + align - 1;
+        std::size_t index = floor_log2(needed);
+        std::uint64_t classes = released_classes.load(std::memory_order_relaxed);
 
-            free += n * sizeof(value_type);
-            free_size -= n;
+        if (!(released[index] && released[index]->offset(align) + bytes <= released[index]->size)) {
+            classes = index + 1 < space_classes ? classes >> (index + 1) << (index + 1) : 0;
+            if (classes == 0) {
+                return nullptr;
+            }
 
-            return result;
+            index = 0;
+            while (!(classes & (std::uint64_t(1) << index))) {
+                ++index;
+            }
         }
 
-        ~Chunk() {
-            delete[] (uint8_t*) data;
+        Chunk* chunk = released[index];
+        released[index] = chunk->next_released;
+        if (!released[index]) {
+            released_classes.fetch_and(~(std::uint64_t(1) << index), std::memory_order_relaxed);
         }
 
-    private:
-        pointer data;
-        size_type free_size;
-        pointer free;
-        Chunk* next;
-    };
+        return chunk;
+    }
+
+    const std::size_t chunk_bytes;
+    const ChunkFallback fallback_policy;
+    const ChunkRecycling recycling_policy;
+    ChunkSource* const source;
+    // Bytes taken from the source per chunk, header included.
+    const std::size_t chunk_total;
+    Control* const control;
+    std::atomic<std::size_t> references;
+    std::atomic<Chunk*> head;
+    // Released chunks by floor(log2(free space)), under the control lock,
+    // and a bit per non-empty class, also read without it as a hint.
+    static const std::size_t space_classes = 64;
+    std::atomic<std::uint64_t> released_classes;
+    Chunk* released[space_classes];
+    // Freed blocks per size class, pushed with a CAS and taken all at once.
+    std::atomic<FreeBlock*> free_lists[class_count];
+};
+
+// Copies share the arena, which is reference counted atomically, so copies
+// may be used and destroyed from different threads at the same time.
+template <typename T>
+class ChunkAllocator {
+public:
+    using value_type = T;
+    using pointer = T*;
+    using const_pointer = const T*;
+    using reference = T&;
+    using const_reference = const T&;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    template <class U> struct rebind { typedef ChunkAllocator<U> other; };
+
+    template <class U> friend class ChunkAllocator;
+
+    static_assert(alignof(T) <= ChunkArena::alignment, "ChunkAllocator does not support this alignment");
+
+    // Elements of T per chunk of an arena created by this type.
+    static const size_type chunk_n = 1024u;
+
+    ChunkAllocator() : ChunkAllocator(ChunkOptions()) {}
+
+    explicit ChunkAllocator(const ChunkOptions& options) : arena(new ChunkArena(with_chunk_size(options))) {}
+
+    explicit ChunkAllocator(ChunkFallback fallback, ChunkRecycling recycling = ChunkRecycling::off) :
+            ChunkAllocator(ChunkOptions{ 0, fallback, recycling, nullptr }) {}
+
+    explicit ChunkAllocator(ChunkRecycling recycling) : ChunkAllocator(ChunkFallback::new_chunk, recycling) {}
+
+    ChunkAllocator(const ChunkAllocator& other) noexcept : arena(other.arena) {
+        this->arena->acquire();
+    }
+
+    template <class U>
+    ChunkAllocator(const ChunkAllocator<U>& other) noexcept : arena(other.arena) {
+        this->arena->acquire();
+    }
+
+    ChunkAllocator& operator=(const ChunkAllocator& other) {
+        ChunkAllocator copy(other);
+        std::swap(this->arena, copy.arena);
+
+        return *this;
+    }
+
+    ~ChunkAllocator() {
+        if (this->arena->release()) {
+            delete this->arena;
+        }
+    }
+
+    // Throws std::bad_alloc if n elements do not fit in a chunk.
+    pointer allocate(const size_type n) {
+        if (n > max_size()) {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<pointer>(this->arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // Returns the block to the arena under ChunkRecycling::size_classes and
+    // does nothing otherwise.
+    void deallocate(pointer ptr, const size_type n) {
+        this->arena->deallocate(ptr, n * sizeof(T), alignof(T));
+    }
+
+    template <typename U, typename ... Args>
+    void construct(U* p, Args&&... args) {
+        new (p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U* p) {
+        p->~U();
+    }
+
+    size_type max_size() const {
+        return this->arena->chunk_size() / sizeof(T);
+    }
+
+    template <class U>
+    bool operator==(const ChunkAllocator<U>& other) const {
+        return this->arena == other.arena;
+    }
+
+    template <class U>
+    bool operator!=(const ChunkAllocator<U>& other) const {
+        return this->arena != other.arena;
+    }
+
+private:
+    static ChunkOptions with_chunk_size(ChunkOptions options) {
+        if (options.chunk_size == 0) {
+            options.chunk_size = chunk_n * sizeof(T);
+        }
+
+        return options;
+    }
 
-    Chunk* head = nullptr;
-    size_type* copy_counter;
+    ChunkArena* arena;
 };
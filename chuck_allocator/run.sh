@@ -0,0 +1,10 @@
+#!/bin/bash
+
+set -e
+
+g++ -std=c++17 -pthread -I./ test/test.cpp -o chunk_allocator_test
+./chunk_allocator_test
+
+rm chunk_allocator_test
+
+echo All tests passed!
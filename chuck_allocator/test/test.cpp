@@ -0,0 +1,310 @@
+#include <iostream>
+#include <string>
+#include <algorithm>
+#include <atomic>
+#include <list>
+#include <map>
+#include <thread>
+#include <vector>
+#include "chunk_allocator.h"
+
+
+// Counts the chunks arenas take from the default source.
+class CountingSource : public ChunkSource {
+public:
+    void* allocate(std::size_t bytes) override {
+        ++total;
+        ++live;
+        return NewChunkSource::instance()->allocate(bytes);
+    }
+
+    void deallocate(void* ptr, std::size_t bytes) override {
+        --live;
+        NewChunkSource::instance()->deallocate(ptr, bytes);
+    }
+
+    std::atomic<size_t> total{0};
+    std::atomic<size_t> live{0};
+};
+
+ChunkOptions Counted(CountingSource& source, size_t chunk_size,
+                     ChunkFallback fallback = ChunkFallback::new_chunk,
+                     ChunkRecycling recycling = ChunkRecycling::off) {
+    return { chunk_size, fallback, recycling, &source };
+}
+
+template <class Body>
+void RunThreads(size_t count, Body body) {
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < count; ++t) {
+        threads.emplace_back(body, t);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+
+void FailWithMsg(const std::string& msg, int line) {
+    std::cerr << "Test failed!\n";
+    std::cerr << "[Line " << line << "] "  << msg << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+#define ASSERT_TRUE(cond) \
+    if (!(cond)) {FailWithMsg("Assertion failed: " #cond, __LINE__);};
+
+#define ASSERT_TRUE_MSG(cond, msg) \
+    if (!(cond)) {FailWithMsg(msg, __LINE__);};
+
+
+int main() {
+
+    {
+        std::list<int, ChunkAllocator<int>> list;
+        for (int i = 0; i < 100'000; ++i) {
+            list.push_back(i);
+        }
+
+        int expected = 0;
+        bool in_order = true;
+        for (int value : list) {
+            in_order = in_order && value == expected++;
+        }
+        ASSERT_TRUE_MSG(in_order && expected == 100'000, "std::list on ChunkAllocator")
+
+        ASSERT_TRUE_MSG(ChunkAllocator<int>().max_size() == ChunkAllocator<int>::chunk_n, "Default chunk size")
+        bool thrown = false;
+        try {
+            ChunkAllocator<int>().allocate(ChunkAllocator<int>::chunk_n + 1);
+        } catch (const std::bad_alloc&) {
+            thrown = true;
+        }
+        ASSERT_TRUE_MSG(thrown, "Block larger than a chunk")
+    }
+
+    {
+        CountingSource source;
+        {
+            ChunkAllocator<int> ints(Counted(source, 4096));
+            ChunkAllocator<double> doubles(ints);
+            ChunkAllocator<int> copy = ints;
+            ChunkAllocator<int> other(Counted(source, 4096));
+
+            ASSERT_TRUE_MSG(ints == doubles && copy == ints && other != ints, "Copies and rebinding share the arena")
+
+            copy = other;
+            ASSERT_TRUE_MSG(copy == other && copy != ints, "Assignment shares the arena")
+
+            int* first = ints.allocate(1);
+            double* second = doubles.allocate(1);
+            ASSERT_TRUE_MSG(reinterpret_cast<char*>(second) - reinterpret_cast<char*>(first) == sizeof(double),
+                            "Rebound allocators bump from the same chunk")
+            ASSERT_TRUE_MSG(source.total == 1, "Rebound allocators bump from the same chunk")
+
+            std::map<int, int, std::less<int>, ChunkAllocator<std::pair<const int, int>>> map(ints);
+            for (int i = 0; i < 1000; ++i) {
+                map[i] = i;
+            }
+            ASSERT_TRUE_MSG(map.size() == 1000 && map.get_allocator() == ints, "Containers rebind the allocator")
+        }
+        ASSERT_TRUE_MSG(source.live == 0, "Chunks freed with the last copy")
+    }
+
+    {
+        // Every thread allocates blocks tagged with its index and hands half
+        // of them to the next thread, which frees them.
+        const size_t threads = 4, count = 20'000;
+
+        for (ChunkRecycling recycling : {ChunkRecycling::off, ChunkRecycling::size_classes}) {
+            for (ChunkFallback fallback : {ChunkFallback::new_chunk, ChunkFallback::best_fit}) {
+                CountingSource source;
+                {
+                    ChunkAllocator<size_t> allocator(Counted(source, 1024, fallback, recycling));
+                    std::vector<std::vector<size_t*>> blocks(threads);
+                    std::atomic<size_t> ready{0};
+                    std::atomic<bool> intact{true};
+
+                    RunThreads(threads, [&](size_t t) {
+                        ChunkAllocator<size_t> local = allocator;
+                        for (size_t i = 0; i < count; ++i) {
+                            size_t n = 1 + i % 16;
+                            size_t* block = local.allocate(n);
+                            std::fill(block, block + n, t);
+                            blocks[t].push_back(block);
+                        }
+
+                        // Frees of our own blocks, then of the neighbour's.
+                        for (size_t i = count / 2; i < count; ++i) {
+                            local.deallocate(blocks[t][i], 1 + i % 16);
+                        }
+                        ++ready;
+                        while (ready < threads) {
+                            std::this_thread::yield();
+                        }
+
+                        size_t other = (t + 1) % threads;
+                        for (size_t i = 0; i < count / 2; ++i) {
+                            size_t n = 1 + i % 16;
+                            if (std::count(blocks[other][i], blocks[other][i] + n, other) != static_cast<long>(n)) {
+                                intact = false;
+                            }
+                        }
+                        ++ready;
+                        while (ready < 2 * threads) {
+                            std::this_thread::yield();
+                        }
+                        for (size_t i = 0; i < count / 2; ++i) {
+                            local.deallocate(blocks[other][i], 1 + i % 16);
+                        }
+
+                        std::vector<size_t*> again;
+                        for (size_t i = 0; i < count; ++i) {
+                            size_t n = 1 + i % 16;
+                            again.push_back(local.allocate(n));
+                            std::fill(again.back(), again.back() + n, t);
+                        }
+                        for (size_t i = 0; i < count; ++i) {
+                            size_t n = 1 + i % 16;
+                            if (std::count(again[i], again[i] + n, t) != static_cast<long>(n)) {
+                                intact = false;
+                            }
+                        }
+                    });
+
+                    ASSERT_TRUE_MSG(intact, "Blocks allocated and freed across threads")
+                }
+                ASSERT_TRUE_MSG(source.live == 0, "Chunks freed with the arena")
+            }
+        }
+    }
+
+    {
+        // The first chunk is given up with 324 bytes left, the second with
+        // 224, and only the first can take the last block.
+        CountingSource source;
+        ChunkAllocator<char> allocator(Counted(source, 1024, ChunkFallback::best_fit));
+        char* first = allocator.allocate(700);
+        allocator.allocate(800);
+        char* last = allocator.allocate(300);
+        ASSERT_TRUE_MSG(last == first + 700 && source.total == 2, "Best fit adopts a released chunk")
+
+        // Blocks of 8 to 256 bytes in a fixed pseudo-random order.
+        size_t totals[2];
+        for (ChunkFallback fallback : {ChunkFallback::new_chunk, ChunkFallback::best_fit}) {
+            CountingSource mixed;
+            ChunkAllocator<char> sizes(Counted(mixed, 1024, fallback));
+            unsigned state = 1;
+            for (size_t i = 0; i < 200'000; ++i) {
+                state = state * 1103515245u + 12345u;
+                sizes.allocate(8 + (state >> 16) % 249)[0] = 1;
+            }
+            totals[fallback == ChunkFallback::best_fit] = mixed.total;
+        }
+        ASSERT_TRUE_MSG(totals[1] < totals[0], "Best fit wastes less on mixed sizes")
+    }
+
+    {
+        // More arenas than a thread caches, used in turn: re-entering an
+        // evicted arena continues in the chunk given back when leaving it.
+        const size_t arenas = 32, blocks = 100'000;
+        CountingSource source;
+        {
+            std::vector<ChunkAllocator<size_t>> allocators;
+            for (size_t i = 0; i < arenas; ++i) {
+                allocators.emplace_back(Counted(source, 4096));
+            }
+
+            for (size_t i = 0; i < blocks; ++i) {
+                *allocators[i % arenas].allocate(1) = i;
+            }
+
+            size_t per_arena = (blocks / arenas + 1) * sizeof(size_t) / 4096 + 1;
+            ASSERT_TRUE_MSG(source.total <= arenas * (per_arena + 1), "Chunks of arenas used in turn")
+        }
+        ASSERT_TRUE_MSG(source.live == 0, "Chunks freed with the arenas")
+    }
+
+    const size_t per_chunk = 4096 / 48;
+
+    {
+        // A window of 1024 live 48-byte blocks sliding over 200000: without
+        // recycling every block is fresh memory, with it the window is reused.
+        const size_t live = 1024, count = 200'000;
+
+        for (ChunkRecycling recycling : {ChunkRecycling::off, ChunkRecycling::size_classes}) {
+            CountingSource source;
+            ChunkAllocator<char> allocator(Counted(source, 4096, ChunkFallback::new_chunk, recycling));
+            std::vector<char*> window(live);
+            for (size_t i = 0; i < count; ++i) {
+                if (i >= live) {
+                    allocator.deallocate(window[i % live], 48);
+                }
+                window[i % live] = allocator.allocate(48);
+            }
+
+            size_t bound = (recycling == ChunkRecycling::off ? count : live) / per_chunk + 1;
+            ASSERT_TRUE_MSG(source.total <= bound, "Chunks under churn")
+        }
+    }
+
+    {
+        // Each round a short-lived thread takes every freed node at once and
+        // uses one: the rest must come back when it exits.
+        CountingSource source;
+        using Map = std::map<int, int, std::less<int>, ChunkAllocator<std::pair<const int, int>>>;
+        Map map(ChunkAllocator<int>(Counted(source, 64 * 1024, ChunkFallback::new_chunk, ChunkRecycling::size_classes)));
+        size_t first_round = 0;
+
+        for (size_t round = 0; round < 5; ++round) {
+            for (int i = 0; i < 100'000; ++i) {
+                map[i] = i;
+            }
+            first_round = round == 0 ? source.total.load() : first_round;
+            map.clear();
+
+            std::thread([&]() {
+                Map other(map.get_allocator());
+                other[0] = 0;
+            }).join();
+        }
+        ASSERT_TRUE_MSG(source.total <= first_round + 1, "Free blocks of exited threads are reused")
+
+        // The same through cache eviction: every visit to one of the arenas
+        // ends with a block taken from a list of 100 freed ones.
+        const size_t arenas = 32;
+        CountingSource evicted;
+        std::vector<ChunkAllocator<char>> allocators;
+        for (size_t i = 0; i < arenas; ++i) {
+            allocators.emplace_back(Counted(evicted, 4096, ChunkFallback::new_chunk, ChunkRecycling::size_classes));
+        }
+
+        for (size_t round = 0; round < 20; ++round) {
+            for (ChunkAllocator<char>& allocator : allocators) {
+                std::vector<char*> blocks;
+                for (size_t i = 0; i < 100; ++i) {
+                    blocks.push_back(allocator.allocate(48));
+                }
+                for (char* block : blocks) {
+                    allocator.deallocate(block, 48);
+                }
+                allocator.deallocate(allocator.allocate(48), 48);
+            }
+        }
+        ASSERT_TRUE_MSG(evicted.total <= arenas * (101 / per_chunk + 2), "Free blocks of evicted arenas are reused")
+    }
+
+    {
+        // Threads leaving an arena give their chunk back to the next one.
+        CountingSource source;
+        ChunkAllocator<int> allocator(Counted(source, 1 << 20));
+        for (size_t i = 0; i < 100; ++i) {
+            std::thread([&]() {
+                ChunkAllocator<int> local = allocator;
+                local.allocate(16);
+            }).join();
+        }
+        ASSERT_TRUE_MSG(source.total == 1, "Chunks of exited threads are adopted")
+    }
+
+}
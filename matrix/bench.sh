@@ -0,0 +1,16 @@
+#!/bin/bash
+
+# Usage: bench.sh [gemm|matrix] [benchmark arguments...]; gemm by default.
+
+set -e
+
+BENCH=gemm
+if [[ "$1" == "gemm" || "$1" == "matrix" ]]; then
+    BENCH=$1
+    shift
+fi
+
+g++ -std=c++17 -O2 -pthread -I./ bench/${BENCH}_bench.cpp src/*.cpp -o ${BENCH}_bench
+./${BENCH}_bench "$@"
+
+rm ${BENCH}_bench
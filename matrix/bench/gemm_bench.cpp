@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "src/matrix.h"
+#include "src/gemm.h"
+
+
+using task::Matrix;
+using task::GemmKernel;
+
+
+Matrix RandomMatrix(size_t rows, size_t cols) {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = dist(rand);
+        }
+    }
+    return temp;
+}
+
+// Best time of several runs, in seconds; repeats until ~0.5s is spent.
+double MeasureProduct(const Matrix& a, const Matrix& b, GemmKernel kernel) {
+    using Clock = std::chrono::steady_clock;
+
+    task::setGemmKernel(kernel);
+
+    double best = 1e100;
+    double total = 0.0;
+    for (size_t run = 0; run < 10 && total < 0.5; ++run) {
+        auto start = Clock::now();
+        Matrix c = a * b;
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        best = std::min(best, elapsed.count());
+        total += elapsed.count();
+    }
+
+    task::setGemmKernel(GemmKernel::kAuto);
+    return best;
+}
+
+
+// Usage: gemm_bench [max_size [max_naive_size]]
+int main(int argc, char** argv) {
+    const size_t max_size = argc > 1 ? std::stoul(argv[1]) : 4096;
+    const size_t max_naive_size = argc > 2 ? std::stoul(argv[2]) : max_size;
+
+    std::cout << std::setw(6) << "n"
+              << std::setw(14) << "naive, s" << std::setw(14) << "GFLOP/s"
+              << std::setw(14) << "blocked, s" << std::setw(14) << "GFLOP/s"
+              << std::setw(10) << "speedup" << "\n";
+    std::cout << std::fixed;
+
+    for (size_t n = 64; n <= max_size; n *= 2) {
+        auto a = RandomMatrix(n, n);
+        auto b = RandomMatrix(n, n);
+        double flops = 2.0 * n * n * n;
+
+        double blocked = MeasureProduct(a, b, GemmKernel::kBlocked);
+
+        std::cout << std::setw(6) << n << std::setprecision(4);
+        if (n <= max_naive_size) {
+            double naive = MeasureProduct(a, b, GemmKernel::kNaive);
+            std::cout << std::setw(14) << naive << std::setw(14) << flops / naive * 1e-9;
+            std::cout << std::setw(14) << blocked << std::setw(14) << flops / blocked * 1e-9;
+            std::cout << std::setw(10) << std::setprecision(2) << naive / blocked << "\n";
+        } else {
+            std::cout << std::setw(14) << "-" << std::setw(14) << "-";
+            std::cout << std::setw(14) << blocked << std::setw(14) << flops / blocked * 1e-9;
+            std::cout << std::setw(10) << "-" << "\n";
+        }
+    }
+}
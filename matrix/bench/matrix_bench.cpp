@@ -0,0 +1,416 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "src/matrix.h"
+#include "src/simd.h"
+#include "src/thread_pool.h"
+
+
+using task::Matrix;
+
+
+// Every allocation in the process goes through these, so each benchmark can
+// report the bytes and allocations of one operation.
+std::atomic<size_t> allocated_bytes(0);
+std::atomic<size_t> allocation_count(0);
+
+void* CountedAllocate(size_t size, size_t alignment) {
+    allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+    void* ptr = alignment <= alignof(std::max_align_t)
+                ? std::malloc(size == 0 ? 1 : size)
+                : std::aligned_alloc(alignment, (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(size_t size) {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](size_t size) {
+    return CountedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return CountedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    std::free(ptr);
+}
+
+
+// Keeps the optimizer from discarding a result.
+template <class T>
+void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+
+Matrix RandomMatrix(size_t rows, size_t cols) {
+    static std::mt19937 rand(42);
+    std::uniform_real_distribution<double> dist{-10., 10.};
+
+    Matrix temp(rows, cols);
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; ++col) {
+            temp[row][col] = dist(rand);
+        }
+    }
+    return temp;
+}
+
+
+struct Options {
+    size_t max_size = 1024;
+    double min_time = 0.05;
+    size_t repetitions = 5;
+    std::string filter;
+    std::string json;
+};
+
+struct Case {
+    std::string name;
+    // Floating-point operations of one call at size n, zero if not meaningful.
+    std::function<double(size_t)> flops;
+    // Largest size worth running, to keep O(n^3) cases bounded.
+    size_t max_size;
+    // Called once per size; returns the operation to time.
+    std::function<std::function<void()>(size_t)> setup;
+};
+
+struct Result {
+    std::string name;
+    size_t size;
+    size_t iterations;
+    double ns_per_op;
+    double ns_min;
+    double gflops;
+    double bytes_per_op;
+    double allocations_per_op;
+};
+
+
+// Median over `repetitions` batches of the time per call, each batch long
+// enough to take about `min_time` seconds.
+Result Measure(const Case& bench, size_t n, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+
+    auto operation = bench.setup(n);
+    operation();
+
+    size_t iterations = 1;
+    while (true) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            operation();
+        }
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        if (elapsed.count() >= options.min_time || iterations >= (1u << 30)) {
+            break;
+        }
+        double scale = elapsed.count() > 0 ? options.min_time / elapsed.count() : 100.;
+        iterations = static_cast<size_t>(iterations * std::min(100., std::max(2., scale * 1.2)));
+    }
+
+    std::vector<double> times;
+    size_t bytes = 0, allocations = 0;
+
+    for (size_t run = 0; run < options.repetitions; ++run) {
+        size_t bytes_before = allocated_bytes.load();
+        size_t allocations_before = allocation_count.load();
+
+        auto start = Clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            operation();
+        }
+        std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+
+        times.push_back(elapsed.count() / iterations);
+        bytes = allocated_bytes.load() - bytes_before;
+        allocations = allocation_count.load() - allocations_before;
+    }
+
+    std::sort(times.begin(), times.end());
+    double median = times[times.size() / 2];
+    double flops = bench.flops ? bench.flops(n) : 0.;
+
+    return Result{ bench.name, n, iterations, median, times.front(),
+                   flops > 0 ? flops / median : 0.,
+                   static_cast<double>(bytes) / iterations, static_cast<double>(allocations) / iterations };
+}
+
+
+std::vector<Case> Cases() {
+    auto cubic = [](double factor) {
+        return [factor](size_t n) { return factor * n * n * n; };
+    };
+    auto square = [](double factor) {
+        return [factor](size_t n) { return factor * n * n; };
+    };
+    const size_t any = static_cast<size_t>(-1);
+
+    return {
+        { "construct", nullptr, any, [](size_t n) {
+            return [n]() { Matrix m(n, n); DoNotOptimize(m[0][0]); };
+        } },
+        { "copy", nullptr, any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() { Matrix m(*a); DoNotOptimize(m[0][0]); };
+        } },
+        { "resize", nullptr, any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto grow = std::make_shared<bool>(true);
+            return [a, grow, n]() {
+                a->resize(*grow ? n + 1 : n, *grow ? n + 1 : n);
+                *grow = !*grow;
+                DoNotOptimize((*a)[0][0]);
+            };
+        } },
+        { "add", square(1.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto b = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a, b]() { Matrix m = *a + *b; DoNotOptimize(m[0][0]); };
+        } },
+        { "add_assign", square(1.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto b = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a, b]() { *a += *b; DoNotOptimize((*a)[0][0]); };
+        } },
+        { "scale", square(1.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() { Matrix m = *a * 1.5; DoNotOptimize(m[0][0]); };
+        } },
+        { "gemm", cubic(2.), 2048, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto b = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a, b]() { Matrix m = *a * *b; DoNotOptimize(m[0][0]); };
+        } },
+        { "gemv", square(2.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto x = std::make_shared<std::vector<double>>(RandomMatrix(n, 1).getColumn(0));
+            return [a, x]() { auto y = *a * *x; DoNotOptimize(y[0]); };
+        } },
+        { "gemv_transposed", square(2.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto x = std::make_shared<std::vector<double>>(RandomMatrix(n, 1).getColumn(0));
+            return [a, x]() { auto y = a->multiplyTransposed(*x); DoNotOptimize(y[0]); };
+        } },
+        { "rank1_update", square(2.), any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto x = std::make_shared<std::vector<double>>(RandomMatrix(n, 1).getColumn(0));
+            return [a, x]() { a->rankOneUpdate(1e-9, *x, *x); DoNotOptimize((*a)[0][0]); };
+        } },
+        { "det", cubic(2. / 3.), 1024, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() { DoNotOptimize(a->det()); };
+        } },
+        { "transposed", nullptr, any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() { Matrix m = a->transposed(); DoNotOptimize(m[0][0]); };
+        } },
+        { "transpose", nullptr, any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() { a->transpose(); DoNotOptimize((*a)[0][0]); };
+        } },
+        { "get_column", nullptr, any, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            auto column = std::make_shared<size_t>(0);
+            return [a, column, n]() {
+                auto values = a->getColumn(*column);
+                *column = (*column + 1) % n;
+                DoNotOptimize(values[0]);
+            };
+        } },
+        { "ostream", nullptr, 512, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            return [a]() {
+                std::ostringstream output;
+                output << *a;
+                DoNotOptimize(output.tellp());
+            };
+        } },
+        { "istream", nullptr, 512, [](size_t n) {
+            auto a = std::make_shared<Matrix>(RandomMatrix(n, n));
+            std::ostringstream output;
+            output << n << " " << n << "\n" << *a;
+            auto text = std::make_shared<std::string>(output.str());
+            return [text]() {
+                std::istringstream input(*text);
+                Matrix m;
+                input >> m;
+                DoNotOptimize(m[0][0]);
+            };
+        } },
+    };
+}
+
+
+std::string SimdLevelName(task::SimdLevel level) {
+    switch (level) {
+        case task::SimdLevel::kAvx512:
+            return "avx512";
+        case task::SimdLevel::kAvx2:
+            return "avx2";
+        case task::SimdLevel::kSse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+std::string EscapeJson(const std::string& text) {
+    std::string result;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+
+void WriteJson(std::ostream& output, const std::vector<Result>& results, const Options& options) {
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    output << std::setprecision(6);
+    output << "{\n";
+    output << "  \"context\": {\n";
+    output << "    \"timestamp\": \"" << timestamp << "\",\n";
+    output << "    \"compiler\": \"" << EscapeJson(__VERSION__) << "\",\n";
+    output << "    \"simd_level\": \"" << SimdLevelName(task::simdLevel()) << "\",\n";
+    output << "    \"threads\": " << task::ThreadPool::instance().threadCount() << ",\n";
+    output << "    \"policy\": \""
+           << (task::defaultExecutionPolicy() == task::ExecutionPolicy::kParallel ? "parallel" : "sequential")
+           << "\",\n";
+    output << "    \"seed\": 42,\n";
+    output << "    \"min_time\": " << options.min_time << ",\n";
+    output << "    \"repetitions\": " << options.repetitions << "\n";
+    output << "  },\n";
+    output << "  \"benchmarks\": [";
+
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        output << (i == 0 ? "\n" : ",\n");
+        output << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+               << ", \"iterations\": " << r.iterations
+               << ", \"ns_per_op\": " << r.ns_per_op << ", \"ns_min\": " << r.ns_min
+               << ", \"gflops\": " << r.gflops
+               << ", \"bytes_per_op\": " << r.bytes_per_op
+               << ", \"allocations_per_op\": " << r.allocations_per_op << "}";
+    }
+    output << "\n  ]\n}\n";
+}
+
+
+// Usage: matrix_bench [--max-size N] [--min-time SECONDS] [--repetitions R]
+//                     [--filter SUBSTRING] [--parallel] [--json FILE]
+int main(int argc, char** argv) {
+    Options options;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--max-size" && has_value) {
+            options.max_size = std::stoul(argv[++i]);
+        } else if (arg == "--min-time" && has_value) {
+            options.min_time = std::stod(argv[++i]);
+        } else if (arg == "--repetitions" && has_value) {
+            options.repetitions = std::max<size_t>(1, std::stoul(argv[++i]));
+        } else if (arg == "--filter" && has_value) {
+            options.filter = argv[++i];
+        } else if (arg == "--json" && has_value) {
+            options.json = argv[++i];
+        } else if (arg == "--parallel") {
+            task::setDefaultExecutionPolicy(task::ExecutionPolicy::kParallel);
+        } else {
+            std::cerr << "Unknown argument " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(12) << "benchmark" << std::right
+              << std::setw(7) << "n" << std::setw(16) << "ns/op" << std::setw(12) << "GFLOP/s"
+              << std::setw(14) << "bytes/op" << std::setw(10) << "allocs" << "\n";
+    std::cout << std::fixed;
+
+    std::vector<Result> results;
+    for (const Case& bench : Cases()) {
+        if (bench.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        for (size_t n = 16; n <= std::min(options.max_size, bench.max_size); n *= 4) {
+            Result result = Measure(bench, n, options);
+            results.push_back(result);
+
+            std::cout << std::left << std::setw(12) << result.name << std::right
+                      << std::setw(7) << result.size
+                      << std::setw(16) << std::setprecision(1) << result.ns_per_op
+                      << std::setw(12) << std::setprecision(2) << result.gflops
+                      << std::setw(14) << std::setprecision(0) << result.bytes_per_op
+                      << std::setw(10) << std::setprecision(1) << result.allocations_per_op << "\n";
+        }
+    }
+
+    if (!options.json.empty()) {
+        std::ofstream output(options.json);
+        WriteJson(output, results, options);
+        if (!output) {
+            std::cerr << "Cannot write " << options.json << "\n";
+            return 1;
+        }
+    }
+}
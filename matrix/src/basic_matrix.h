@@ -0,0 +1,130 @@
+#pragma once
+
+#include <complex>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// Dense row-major matrix of T: float, long double, int64_t or
+// std::complex<double>. Matrix, the double specialization, is declared in
+// matrix.h and keeps its own implementation.
+//
+// The interface follows Matrix, except that operator[] returns a pointer to
+// the row and arithmetic is evaluated eagerly. float matrices use the
+// single-precision SIMD kernels, integer matrices compare exactly and
+// compute det() with fraction-free Bareiss elimination, so it is exact
+// whenever the result fits in T.
+//
+// The eager code below deliberately repeats the shape of Matrix rather than
+// sharing it: the Matrix side is built on padded rows, Row headers, views
+// and expression templates over double, none of which this layout has, so a
+// common base would reduce to the size checks. Behaviour that callers can
+// observe, such as which exceptions are thrown, must be kept in step by hand.
+template <class T>
+class BasicMatrix {
+
+public:
+    using value_type = T;
+
+    static const size_t kAlignment = 64;
+
+    BasicMatrix();
+    BasicMatrix(size_t rows, size_t cols);
+    BasicMatrix(const BasicMatrix& copy);
+    BasicMatrix(BasicMatrix&& other) noexcept;
+    BasicMatrix& operator=(const BasicMatrix& a);
+    BasicMatrix& operator=(BasicMatrix&& a) noexcept;
+    ~BasicMatrix();
+
+    T& get(size_t row, size_t col);
+    const T& get(size_t row, size_t col) const;
+    void set(size_t row, size_t col, const T& value);
+    void resize(size_t new_rows, size_t new_cols);
+
+    T* operator[](size_t row);
+    const T* operator[](size_t row) const;
+
+    BasicMatrix& operator+=(const BasicMatrix& a);
+    BasicMatrix& operator-=(const BasicMatrix& a);
+    BasicMatrix& operator*=(const BasicMatrix& a);
+    BasicMatrix& operator*=(const T& number);
+
+    BasicMatrix operator+(const BasicMatrix& a) const;
+    BasicMatrix operator-(const BasicMatrix& a) const;
+    BasicMatrix operator*(const BasicMatrix& a) const;
+    BasicMatrix operator*(const T& number) const;
+
+    BasicMatrix operator-() const;
+    BasicMatrix operator+() const;
+
+    T det() const;
+    void transpose();
+    BasicMatrix transposed() const;
+    T trace() const;
+
+    std::vector<T> getRow(size_t row) const;
+    std::vector<T> getColumn(size_t column) const;
+
+    bool operator==(const BasicMatrix& a) const;
+    bool operator!=(const BasicMatrix& a) const;
+
+    std::pair<size_t, size_t> size() const;
+
+    // Rows are not padded: row i starts at rawData() + i * stride().
+    size_t stride() const;
+    T* rawData();
+    const T* rawData() const;
+
+private:
+    // Builds a matrix whose elements are default-initialized, which leaves
+    // arithmetic types uninitialized; the caller fills every element.
+    struct Uninitialized {};
+    BasicMatrix(size_t rows, size_t cols, Uninitialized);
+
+    void allocate(size_t rows, size_t cols, bool zeroed = true);
+    void release();
+    void swap(BasicMatrix& other) noexcept;
+
+    // Calls kernel(offset, length) for pieces of the buffer, on the thread
+    // pool under the default execution policy.
+    template <class Kernel>
+    void forEachSpan(Kernel kernel) const;
+
+    T eliminationDet() const;
+    T bareissDet() const;
+
+    T* elements;
+    std::pair<size_t, size_t> dim_size;
+
+};
+
+template <class T>
+BasicMatrix<T> operator*(const T& number, const BasicMatrix<T>& a);
+
+// Element-wise static_cast, in either direction between Matrix and BasicMatrix.
+template <class To, class From>
+BasicMatrix<To> matrixCast(const BasicMatrix<From>& a);
+
+template <class T>
+std::ostream& operator<<(std::ostream& output, const BasicMatrix<T>& matrix);
+
+template <class T>
+std::istream& operator>>(std::istream& input, BasicMatrix<T>& matrix);
+
+using FloatMatrix = BasicMatrix<float>;
+using LongDoubleMatrix = BasicMatrix<long double>;
+using IntMatrix = BasicMatrix<int64_t>;
+using ComplexMatrix = BasicMatrix<std::complex<double>>;
+
+}  // namespace task
+
+
+#include "basic_matrix.tpp"
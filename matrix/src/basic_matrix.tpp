@@ -0,0 +1,590 @@
+#include "basic_matrix.h"
+
+#include <algorithm>
+#include <memory>
+#include <new>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+namespace task {
+
+    namespace basic {
+
+        // Elements per parallel chunk, as for Matrix.
+        const size_t kParallelGrain = 1 << 15;
+
+        // Element-wise loops; float goes through the SIMD kernels instead.
+        template <class T>
+        struct Kernels {
+            static void add(const T* a, const T* b, T* out, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = a[i] + b[i];
+                }
+            }
+
+            static void sub(const T* a, const T* b, T* out, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = a[i] - b[i];
+                }
+            }
+
+            static void scale(const T* a, const T& factor, T* out, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = a[i] * factor;
+                }
+            }
+
+            static void negate(const T* a, T* out, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    out[i] = -a[i];
+                }
+            }
+
+            static void axpy(const T& factor, const T* x, T* y, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    y[i] += factor * x[i];
+                }
+            }
+
+            // Integers compare exactly, everything else within EPS.
+            static bool equal(const T* a, const T* b, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    if constexpr (std::is_integral<T>::value) {
+                        if (a[i] != b[i]) {
+                            return false;
+                        }
+                    } else if (std::abs(a[i] - b[i]) >= EPS) {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+        };
+
+        template <>
+        struct Kernels<float> {
+            static void add(const float* a, const float* b, float* out, size_t n) {
+                simd::add(a, b, out, n);
+            }
+
+            static void sub(const float* a, const float* b, float* out, size_t n) {
+                simd::sub(a, b, out, n);
+            }
+
+            static void scale(const float* a, const float& factor, float* out, size_t n) {
+                simd::scale(a, factor, out, n);
+            }
+
+            static void negate(const float* a, float* out, size_t n) {
+                simd::negate(a, out, n);
+            }
+
+            static void axpy(const float& factor, const float* x, float* y, size_t n) {
+                simd::axpy(factor, x, y, n);
+            }
+
+            static bool equal(const float* a, const float* b, size_t n) {
+                return simd::equal(a, b, n, static_cast<float>(EPS));
+            }
+        };
+
+    }  // namespace basic
+
+    template <class T>
+    void BasicMatrix<T>::allocate(size_t rows, size_t cols, bool zeroed) {
+        size_t bytes = std::max<size_t>(rows * cols * sizeof(T), 1);
+        void* buffer = ::operator new(bytes, std::align_val_t(kAlignment));
+
+        this->elements = static_cast<T*>(buffer);
+        this->dim_size = { rows, cols };
+        if (zeroed) {
+            std::uninitialized_value_construct_n(this->elements, rows * cols);
+        } else {
+            std::uninitialized_default_construct_n(this->elements, rows * cols);
+        }
+    }
+
+    template <class T>
+    void BasicMatrix<T>::release() {
+        if (this->elements != nullptr) {
+            std::destroy_n(this->elements, this->dim_size.first * this->dim_size.second);
+            ::operator delete(static_cast<void*>(this->elements), std::align_val_t(kAlignment));
+        }
+        this->elements = nullptr;
+    }
+
+    template <class T>
+    void BasicMatrix<T>::swap(BasicMatrix& other) noexcept {
+        std::swap(this->elements, other.elements);
+        std::swap(this->dim_size, other.dim_size);
+    }
+
+    template <class T>
+    BasicMatrix<T>::BasicMatrix() : BasicMatrix(1, 1) {}
+
+    template <class T>
+    BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols) {
+        allocate(rows, cols);
+
+        for (size_t i = 0; i < std::min(cols, rows); ++i) {
+            this->elements[i * cols + i] = T(1);
+        }
+    }
+
+    template <class T>
+    BasicMatrix<T>::BasicMatrix(size_t rows, size_t cols, Uninitialized) {
+        allocate(rows, cols, false);
+    }
+
+    template <class T>
+    BasicMatrix<T>::BasicMatrix(const BasicMatrix& copy) {
+        allocate(copy.dim_size.first, copy.dim_size.second);
+        std::copy_n(copy.elements, copy.dim_size.first * copy.dim_size.second, this->elements);
+    }
+
+    template <class T>
+    BasicMatrix<T>::BasicMatrix(BasicMatrix&& other) noexcept : elements(nullptr), dim_size(0, 0) {
+        swap(other);
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator=(const BasicMatrix& a) {
+        if (&a == this) {
+            return *this;
+        }
+
+        if (this->dim_size != a.dim_size) {
+            BasicMatrix copy(a);
+            swap(copy);
+        } else {
+            std::copy_n(a.elements, a.dim_size.first * a.dim_size.second, this->elements);
+        }
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator=(BasicMatrix&& a) noexcept {
+        if (&a != this) {
+            BasicMatrix expiring(std::move(a));
+            swap(expiring);
+        }
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T>::~BasicMatrix() {
+        release();
+    }
+
+    template <class T>
+    T& BasicMatrix<T>::get(size_t row, size_t col) {
+        if (row < this->dim_size.first && col < this->dim_size.second) {
+            return this->elements[row * this->dim_size.second + col];
+        } else {
+            throw OutOfBoundsException();
+        }
+    }
+
+    template <class T>
+    const T& BasicMatrix<T>::get(size_t row, size_t col) const {
+        if (row < this->dim_size.first && col < this->dim_size.second) {
+            return this->elements[row * this->dim_size.second + col];
+        } else {
+            throw OutOfBoundsException();
+        }
+    }
+
+    template <class T>
+    void BasicMatrix<T>::set(size_t row, size_t col, const T& value) {
+        get(row, col) = value;
+    }
+
+    template <class T>
+    void BasicMatrix<T>::resize(size_t new_rows, size_t new_cols) {
+        if (this->dim_size == std::make_pair(new_rows, new_cols)) {
+            return;
+        }
+
+        BasicMatrix resized(0, 0);
+        resized.release();
+        resized.allocate(new_rows, new_cols);
+
+        size_t row_size = std::min(this->dim_size.first, new_rows);
+        size_t col_size = std::min(this->dim_size.second, new_cols);
+
+        for (size_t i = 0; i < row_size; ++i) {
+            std::copy_n((*this)[i], col_size, resized[i]);
+        }
+
+        swap(resized);
+    }
+
+    template <class T>
+    T* BasicMatrix<T>::operator[](size_t row) {
+        if (row < this->dim_size.first) {
+            return this->elements + row * this->dim_size.second;
+        } else {
+            throw OutOfBoundsException();
+        }
+    }
+
+    template <class T>
+    const T* BasicMatrix<T>::operator[](size_t row) const {
+        if (row < this->dim_size.first) {
+            return this->elements + row * this->dim_size.second;
+        } else {
+            throw OutOfBoundsException();
+        }
+    }
+
+    template <class T>
+    template <class Kernel>
+    void BasicMatrix<T>::forEachSpan(Kernel kernel) const {
+        size_t count = this->dim_size.first * this->dim_size.second;
+
+        parallelFor(defaultExecutionPolicy(), 0, count, basic::kParallelGrain, [&](size_t begin, size_t end) {
+            kernel(begin, end - begin);
+        });
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator+=(const BasicMatrix& a) {
+        if (this->size() != a.size()) {
+            throw SizeMismatchException();
+        }
+
+        forEachSpan([&](size_t offset, size_t length) {
+            basic::Kernels<T>::add(this->elements + offset, a.elements + offset, this->elements + offset, length);
+        });
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator-=(const BasicMatrix& a) {
+        if (this->size() != a.size()) {
+            throw SizeMismatchException();
+        }
+
+        forEachSpan([&](size_t offset, size_t length) {
+            basic::Kernels<T>::sub(this->elements + offset, a.elements + offset, this->elements + offset, length);
+        });
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator*=(const T& number) {
+        forEachSpan([&](size_t offset, size_t length) {
+            basic::Kernels<T>::scale(this->elements + offset, number, this->elements + offset, length);
+        });
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T>& BasicMatrix<T>::operator*=(const BasicMatrix& a) {
+        *this = *this * a;
+
+        return *this;
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator+(const BasicMatrix& a) const {
+        BasicMatrix result(*this);
+        return result += a;
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator-(const BasicMatrix& a) const {
+        BasicMatrix result(*this);
+        return result -= a;
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator*(const T& number) const {
+        BasicMatrix result(*this);
+        return result *= number;
+    }
+
+    // Row i of the result accumulates a[i][k] * row k of `a` for every k, so
+    // all accesses are sequential and the inner loop is an axpy.
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator*(const BasicMatrix& a) const {
+        if (this->dim_size.second != a.dim_size.first) {
+            throw SizeMismatchException();
+        }
+
+        size_t rows = this->dim_size.first;
+        size_t inner = this->dim_size.second;
+        size_t cols = a.dim_size.second;
+
+        BasicMatrix result(rows, cols);
+        std::fill_n(result.elements, rows * cols, T());
+
+        size_t grain = basic::kParallelGrain / (inner * cols + 1) + 1;
+        parallelFor(defaultExecutionPolicy(), 0, rows, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t k = 0; k < inner; ++k) {
+                    basic::Kernels<T>::axpy(this->elements[i * inner + k], a.elements + k * cols,
+                                            result.elements + i * cols, cols);
+                }
+            }
+        });
+
+        return result;
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator-() const {
+        BasicMatrix result(this->dim_size.first, this->dim_size.second, Uninitialized());
+
+        forEachSpan([&](size_t offset, size_t length) {
+            basic::Kernels<T>::negate(this->elements + offset, result.elements + offset, length);
+        });
+
+        return result;
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::operator+() const {
+        return *this;
+    }
+
+    template <class T>
+    T BasicMatrix<T>::det() const {
+        if (this->dim_size.first != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        if constexpr (std::is_integral<T>::value) {
+            return bareissDet();
+        } else {
+            return eliminationDet();
+        }
+    }
+
+    // Gaussian elimination with partial pivoting; a pivot below EPS in
+    // magnitude makes the determinant zero, as in Matrix::det().
+    template <class T>
+    T BasicMatrix<T>::eliminationDet() const {
+        size_t n = this->dim_size.first;
+        BasicMatrix a(*this);
+        T result = T(1);
+
+        for (size_t j = 0; j < n; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < n; ++i) {
+                if (std::abs(a[i][j]) > std::abs(a[pivot][j])) {
+                    pivot = i;
+                }
+            }
+
+            if (std::abs(a[pivot][j]) < EPS) {
+                return T();
+            }
+            if (pivot != j) {
+                std::swap_ranges(a[j], a[j] + n, a[pivot]);
+                result = -result;
+            }
+
+            result *= a[j][j];
+            for (size_t i = j + 1; i < n; ++i) {
+                T factor = a[i][j] / a[j][j];
+                basic::Kernels<T>::axpy(-factor, a[j] + j + 1, a[i] + j + 1, n - j - 1);
+            }
+        }
+
+        return result;
+    }
+
+    // Every division in Bareiss' recurrence is exact, so integers stay
+    // integers. Products are formed in 128 bits, so intermediate values only
+    // overflow when a minor of the matrix does.
+    template <class T>
+    T BasicMatrix<T>::bareissDet() const {
+        using Wide = std::conditional_t<sizeof(T) <= sizeof(int64_t), __int128, T>;
+
+        size_t n = this->dim_size.first;
+        BasicMatrix a(*this);
+        T previous = T(1);
+        bool negative = false;
+
+        for (size_t k = 0; k < n; ++k) {
+            if (a[k][k] == 0) {
+                size_t pivot = k + 1;
+                while (pivot < n && a[pivot][k] == 0) {
+                    ++pivot;
+                }
+                if (pivot == n) {
+                    return T();
+                }
+
+                std::swap_ranges(a[k], a[k] + n, a[pivot]);
+                negative = !negative;
+            }
+
+            for (size_t i = k + 1; i < n; ++i) {
+                for (size_t j = k + 1; j < n; ++j) {
+                    Wide value = Wide(a[i][j]) * a[k][k] - Wide(a[i][k]) * a[k][j];
+                    a[i][j] = static_cast<T>(value / previous);
+                }
+            }
+            previous = a[k][k];
+        }
+
+        if (n == 0) {
+            return T(1);
+        }
+        return negative ? -a[n - 1][n - 1] : a[n - 1][n - 1];
+    }
+
+    template <class T>
+    void BasicMatrix<T>::transpose() {
+        BasicMatrix result = transposed();
+        swap(result);
+    }
+
+    template <class T>
+    BasicMatrix<T> BasicMatrix<T>::transposed() const {
+        size_t rows = this->dim_size.first;
+        size_t cols = this->dim_size.second;
+        BasicMatrix result(cols, rows);
+
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                result.elements[j * rows + i] = this->elements[i * cols + j];
+            }
+        }
+
+        return result;
+    }
+
+    template <class T>
+    T BasicMatrix<T>::trace() const {
+        if (this->dim_size.first != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        T result = T();
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            result += (*this)[i][i];
+        }
+
+        return result;
+    }
+
+    template <class T>
+    std::vector<T> BasicMatrix<T>::getRow(size_t row) const {
+        const T* begin = (*this)[row];
+        return std::vector<T>(begin, begin + this->dim_size.second);
+    }
+
+    template <class T>
+    std::vector<T> BasicMatrix<T>::getColumn(size_t column) const {
+        if (column >= this->dim_size.second) {
+            throw OutOfBoundsException();
+        }
+
+        std::vector<T> result(this->dim_size.first);
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            result[i] = (*this)[i][column];
+        }
+
+        return result;
+    }
+
+    template <class T>
+    bool BasicMatrix<T>::operator==(const BasicMatrix& a) const {
+        if (this->size() != a.size()) {
+            throw SizeMismatchException();
+        }
+        return basic::Kernels<T>::equal(this->elements, a.elements, this->dim_size.first * this->dim_size.second);
+    }
+
+    template <class T>
+    bool BasicMatrix<T>::operator!=(const BasicMatrix& a) const {
+        return !(*this == a);
+    }
+
+    template <class T>
+    std::pair<size_t, size_t> BasicMatrix<T>::size() const {
+        return this->dim_size;
+    }
+
+    template <class T>
+    size_t BasicMatrix<T>::stride() const {
+        return this->dim_size.second;
+    }
+
+    template <class T>
+    T* BasicMatrix<T>::rawData() {
+        return this->elements;
+    }
+
+    template <class T>
+    const T* BasicMatrix<T>::rawData() const {
+        return this->elements;
+    }
+
+    template <class T>
+    BasicMatrix<T> operator*(const T& number, const BasicMatrix<T>& a) {
+        return a * number;
+    }
+
+    template <class To, class From>
+    BasicMatrix<To> matrixCast(const BasicMatrix<From>& a) {
+        auto[rows, cols] = a.size();
+        BasicMatrix<To> result(rows, cols);
+
+        for (size_t i = 0; i < rows; ++i) {
+            const From* source = a.rawData() + i * a.stride();
+            To* target = result.rawData() + i * result.stride();
+
+            for (size_t j = 0; j < cols; ++j) {
+                target[j] = static_cast<To>(source[j]);
+            }
+        }
+
+        return result;
+    }
+
+    template <class T>
+    std::ostream& operator<<(std::ostream& output, const BasicMatrix<T>& matrix) {
+        auto[rows, cols] = matrix.size();
+
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                output << matrix[i][j] << " ";
+            }
+            output << "\n";
+        }
+
+        return output;
+    }
+
+    template <class T>
+    std::istream& operator>>(std::istream& input, BasicMatrix<T>& matrix) {
+        size_t rows, cols;
+        if (!(input >> rows >> cols)) {
+            return input;
+        }
+
+        BasicMatrix<T> result(rows, cols);
+        for (size_t i = 0; i < rows; ++i) {
+            for (size_t j = 0; j < cols; ++j) {
+                if (!(input >> result[i][j])) {
+                    return input;
+                }
+            }
+        }
+
+        matrix = std::move(result);
+        return input;
+    }
+
+}  // namespace task
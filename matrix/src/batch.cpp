@@ -0,0 +1,354 @@
+#include "batch.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <new>
+
+namespace task {
+
+    namespace {
+
+        // Lanes are padded to whole 64-byte lines.
+        const size_t kLaneAlignment = 8;
+
+        // Bytes of matrix data per chunk, so that a chunk of every operand
+        // stays in L2.
+        const size_t kChunkBytes = 1 << 16;
+
+        size_t roundUp(size_t value, size_t multiple) {
+            return (value + multiple - 1) / multiple * multiple;
+        }
+
+        // Gaussian elimination over a chunk of `len` n x n matrices, with
+        // element (i, j) of all of them at a + (i * n + j) * len. Every
+        // matrix chooses its own pivot rows; a pivot below EPS in magnitude
+        // marks the matrix singular and is replaced by 1 so that the shared
+        // arithmetic stays finite.
+        //
+        // Without `inverse` the lower triangle is eliminated and `det`
+        // receives the determinants. With it, elimination runs Gauss-Jordan
+        // style over both triangles and `inverse`, holding identities laid
+        // out like `a`, becomes the inverses.
+        void eliminate(size_t n, size_t len, double* a, double* inverse, double* det, std::vector<char>& singular) {
+            auto at = [&](double* base, size_t i, size_t j) {
+                return base + (i * n + j) * len;
+            };
+
+            std::vector<double> reciprocal(len), factor(len);
+            std::fill_n(det, len, 1.0);
+
+            for (size_t j = 0; j < n; ++j) {
+                for (size_t l = 0; l < len; ++l) {
+                    size_t pivot = j;
+                    for (size_t i = j + 1; i < n; ++i) {
+                        if (std::fabs(at(a, i, j)[l]) > std::fabs(at(a, pivot, j)[l])) {
+                            pivot = i;
+                        }
+                    }
+
+                    if (pivot != j) {
+                        for (size_t k = 0; k < n; ++k) {
+                            std::swap(at(a, j, k)[l], at(a, pivot, k)[l]);
+                        }
+                        if (inverse != nullptr) {
+                            for (size_t k = 0; k < n; ++k) {
+                                std::swap(at(inverse, j, k)[l], at(inverse, pivot, k)[l]);
+                            }
+                        }
+                        det[l] = -det[l];
+                    }
+
+                    double& value = at(a, j, j)[l];
+                    if (std::fabs(value) < EPS) {
+                        singular[l] = true;
+                        det[l] = 0.0;
+                        value = 1.0;
+                    }
+                    reciprocal[l] = 1.0 / value;
+                }
+
+                simd::multiply(det, at(a, j, j), det, len);
+
+                if (inverse == nullptr) {
+                    for (size_t i = j + 1; i < n; ++i) {
+                        simd::multiply(at(a, i, j), reciprocal.data(), factor.data(), len);
+                        simd::negate(factor.data(), factor.data(), len);
+
+                        for (size_t k = j + 1; k < n; ++k) {
+                            simd::multiplyAdd(factor.data(), at(a, j, k), at(a, i, k), len);
+                        }
+                    }
+                    continue;
+                }
+
+                for (size_t k = j; k < n; ++k) {
+                    simd::multiply(at(a, j, k), reciprocal.data(), at(a, j, k), len);
+                }
+                for (size_t k = 0; k < n; ++k) {
+                    simd::multiply(at(inverse, j, k), reciprocal.data(), at(inverse, j, k), len);
+                }
+
+                for (size_t i = 0; i < n; ++i) {
+                    if (i == j) {
+                        continue;
+                    }
+
+                    simd::negate(at(a, i, j), factor.data(), len);
+                    for (size_t k = j; k < n; ++k) {
+                        simd::multiplyAdd(factor.data(), at(a, j, k), at(a, i, k), len);
+                    }
+                    for (size_t k = 0; k < n; ++k) {
+                        simd::multiplyAdd(factor.data(), at(inverse, j, k), at(inverse, i, k), len);
+                    }
+                }
+            }
+        }
+
+    }  // namespace
+
+    void MatrixBatch::AlignedDelete::operator()(double* ptr) const {
+        ::operator delete(static_cast<void*>(ptr), std::align_val_t(64));
+    }
+
+    MatrixBatch::MatrixBatch(size_t count, size_t rows, size_t cols) :
+            dim_size(rows, cols), matrices(count), lane_stride(roundUp(count, kLaneAlignment)) {
+        size_t size = std::max<size_t>(rows * cols * this->lane_stride, 1);
+        this->elements.reset(static_cast<double*>(::operator new(size * sizeof(double), std::align_val_t(64))));
+        std::fill_n(this->elements.get(), size, 0.0);
+
+        for (size_t i = 0; i < std::min(rows, cols); ++i) {
+            std::fill_n(lane(i, i), count, 1.0);
+        }
+    }
+
+    MatrixBatch::MatrixBatch(const std::vector<Matrix>& matrices) :
+            MatrixBatch(matrices.size(), matrices.empty() ? 0 : matrices[0].size().first,
+                        matrices.empty() ? 0 : matrices[0].size().second) {
+        if (matrices.empty()) {
+            throw SizeMismatchException();
+        }
+
+        for (size_t index = 0; index < matrices.size(); ++index) {
+            set(index, matrices[index]);
+        }
+    }
+
+    MatrixBatch::MatrixBatch(const MatrixBatch& copy) :
+            MatrixBatch(copy.matrices, copy.dim_size.first, copy.dim_size.second) {
+        std::copy_n(copy.elements.get(), this->dim_size.first * this->dim_size.second * this->lane_stride,
+                    this->elements.get());
+    }
+
+    MatrixBatch::MatrixBatch(MatrixBatch&& other) noexcept = default;
+
+    MatrixBatch& MatrixBatch::operator=(const MatrixBatch& a) {
+        if (&a != this) {
+            *this = MatrixBatch(a);
+        }
+
+        return *this;
+    }
+
+    MatrixBatch& MatrixBatch::operator=(MatrixBatch&& a) noexcept = default;
+
+    size_t MatrixBatch::count() const {
+        return this->matrices;
+    }
+
+    std::pair<size_t, size_t> MatrixBatch::shape() const {
+        return this->dim_size;
+    }
+
+    Matrix MatrixBatch::get(size_t index) const {
+        if (index >= this->matrices) {
+            throw OutOfBoundsException();
+        }
+
+        Matrix result(this->dim_size.first, this->dim_size.second);
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            for (size_t j = 0; j < this->dim_size.second; ++j) {
+                result[i][j] = lane(i, j)[index];
+            }
+        }
+
+        return result;
+    }
+
+    void MatrixBatch::set(size_t index, const Matrix& matrix) {
+        if (index >= this->matrices) {
+            throw OutOfBoundsException();
+        }
+        if (matrix.size() != this->dim_size) {
+            throw SizeMismatchException();
+        }
+
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            for (size_t j = 0; j < this->dim_size.second; ++j) {
+                lane(i, j)[index] = matrix[i][j];
+            }
+        }
+    }
+
+    std::vector<Matrix> MatrixBatch::toMatrices() const {
+        std::vector<Matrix> result;
+        result.reserve(this->matrices);
+
+        for (size_t index = 0; index < this->matrices; ++index) {
+            result.push_back(get(index));
+        }
+
+        return result;
+    }
+
+    double& MatrixBatch::get(size_t index, size_t row, size_t col) {
+        if (index >= this->matrices || row >= this->dim_size.first || col >= this->dim_size.second) {
+            throw OutOfBoundsException();
+        }
+
+        return lane(row, col)[index];
+    }
+
+    const double& MatrixBatch::get(size_t index, size_t row, size_t col) const {
+        if (index >= this->matrices || row >= this->dim_size.first || col >= this->dim_size.second) {
+            throw OutOfBoundsException();
+        }
+
+        return lane(row, col)[index];
+    }
+
+    double* MatrixBatch::lane(size_t row, size_t col) {
+        return this->elements.get() + (row * this->dim_size.second + col) * this->lane_stride;
+    }
+
+    const double* MatrixBatch::lane(size_t row, size_t col) const {
+        return this->elements.get() + (row * this->dim_size.second + col) * this->lane_stride;
+    }
+
+    size_t MatrixBatch::stride() const {
+        return this->lane_stride;
+    }
+
+    size_t MatrixBatch::chunkSize(size_t elements) {
+        size_t size = kChunkBytes / (sizeof(double) * std::max<size_t>(elements, 1));
+        return std::max(kLaneAlignment, size / kLaneAlignment * kLaneAlignment);
+    }
+
+    // C(i, j) += A(i, p) * B(p, j) lane by lane, so each step is one
+    // multiply-add across the chunk.
+    MatrixBatch MatrixBatch::operator*(const MatrixBatch& a) const {
+        if (this->matrices != a.matrices || this->dim_size.second != a.dim_size.first) {
+            throw SizeMismatchException();
+        }
+
+        size_t m = this->dim_size.first;
+        size_t k = this->dim_size.second;
+        size_t n = a.dim_size.second;
+
+        MatrixBatch result(this->matrices, m, n);
+        size_t chunk = chunkSize(m * k + k * n + m * n);
+        size_t chunks = (this->matrices + chunk - 1) / chunk;
+
+        parallelFor(defaultExecutionPolicy(), 0, chunks, 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c) {
+                size_t first = c * chunk;
+                size_t len = std::min(chunk, this->matrices - first);
+
+                for (size_t i = 0; i < m; ++i) {
+                    for (size_t j = 0; j < n; ++j) {
+                        double* out = result.lane(i, j) + first;
+                        std::fill_n(out, len, 0.0);
+
+                        for (size_t p = 0; p < k; ++p) {
+                            simd::multiplyAdd(lane(i, p) + first, a.lane(p, j) + first, out, len);
+                        }
+                    }
+                }
+            }
+        });
+
+        return result;
+    }
+
+    std::vector<double> MatrixBatch::det() const {
+        if (this->dim_size.first != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        size_t n = this->dim_size.first;
+        std::vector<double> result(this->matrices);
+        size_t chunk = chunkSize(n * n);
+        size_t chunks = (this->matrices + chunk - 1) / chunk;
+
+        parallelFor(defaultExecutionPolicy(), 0, chunks, 1, [&](size_t begin, size_t end) {
+            std::vector<double> a(n * n * chunk);
+            std::vector<char> singular(chunk);
+
+            for (size_t c = begin; c < end; ++c) {
+                size_t first = c * chunk;
+                size_t len = std::min(chunk, this->matrices - first);
+
+                for (size_t e = 0; e < n * n; ++e) {
+                    std::copy_n(lane(e / n, e % n) + first, len, a.data() + e * len);
+                }
+                eliminate(n, len, a.data(), nullptr, result.data() + first, singular);
+            }
+        });
+
+        return result;
+    }
+
+    std::vector<double> MatrixBatch::trace() const {
+        if (this->dim_size.first != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        std::vector<double> result(this->matrices, 0.0);
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            simd::add(result.data(), lane(i, i), result.data(), this->matrices);
+        }
+
+        return result;
+    }
+
+    MatrixBatch MatrixBatch::inverse() const {
+        if (this->dim_size.first != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        size_t n = this->dim_size.first;
+        MatrixBatch result(this->matrices, n, n);
+        size_t chunk = chunkSize(2 * n * n);
+        size_t chunks = (this->matrices + chunk - 1) / chunk;
+        std::vector<char> singular(chunks * chunk);
+
+        parallelFor(defaultExecutionPolicy(), 0, chunks, 1, [&](size_t begin, size_t end) {
+            std::vector<double> a(n * n * chunk), inverse(n * n * chunk), det(chunk);
+            std::vector<char> flags(chunk);
+
+            for (size_t c = begin; c < end; ++c) {
+                size_t first = c * chunk;
+                size_t len = std::min(chunk, this->matrices - first);
+
+                std::fill(flags.begin(), flags.end(), false);
+                for (size_t e = 0; e < n * n; ++e) {
+                    std::copy_n(lane(e / n, e % n) + first, len, a.data() + e * len);
+                    std::fill_n(inverse.data() + e * len, len, e / n == e % n ? 1.0 : 0.0);
+                }
+                eliminate(n, len, a.data(), inverse.data(), det.data(), flags);
+
+                for (size_t e = 0; e < n * n; ++e) {
+                    std::copy_n(inverse.data() + e * len, len, result.lane(e / n, e % n) + first);
+                }
+                std::copy_n(flags.begin(), len, singular.begin() + first);
+            }
+        });
+
+        if (std::find(singular.begin(), singular.end(), true) != singular.end()) {
+            throw SingularMatrixException();
+        }
+
+        return result;
+    }
+
+}  // namespace task
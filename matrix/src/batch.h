@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// A batch of `count` independent rows x cols matrices, stored interleaved:
+// element (row, col) of every matrix in the batch is one contiguous lane,
+// lane(row, col)[index]. Products, determinants and inverses apply the same
+// operation to every matrix, so each step is a SIMD kernel running across
+// the batch, and there is one allocation for all of them.
+//
+// Work is split into chunks of matrices small enough to stay in cache,
+// which run on the thread pool under the default execution policy.
+class MatrixBatch {
+public:
+    // Like Matrix, every matrix starts with ones on the diagonal.
+    MatrixBatch(size_t count, size_t rows, size_t cols);
+
+    // Throws SizeMismatchException if `matrices` is empty or the shapes differ.
+    explicit MatrixBatch(const std::vector<Matrix>& matrices);
+
+    MatrixBatch(const MatrixBatch& copy);
+    MatrixBatch(MatrixBatch&& other) noexcept;
+    MatrixBatch& operator=(const MatrixBatch& a);
+    MatrixBatch& operator=(MatrixBatch&& a) noexcept;
+
+    size_t count() const;
+    std::pair<size_t, size_t> shape() const;
+
+    // Throw OutOfBoundsException for an index outside the batch; set() also
+    // throws SizeMismatchException if the matrix has a different shape.
+    Matrix get(size_t index) const;
+    void set(size_t index, const Matrix& matrix);
+    std::vector<Matrix> toMatrices() const;
+
+    double& get(size_t index, size_t row, size_t col);
+    const double& get(size_t index, size_t row, size_t col) const;
+
+    // Lanes are 64-byte aligned and stride() elements apart.
+    double* lane(size_t row, size_t col);
+    const double* lane(size_t row, size_t col) const;
+    size_t stride() const;
+
+    // Pairwise product of the i-th matrices. Throws SizeMismatchException
+    // unless the counts are equal and the shapes compatible.
+    MatrixBatch operator*(const MatrixBatch& a) const;
+
+    // Square batches only; pivoting is chosen per matrix, as in Matrix::det().
+    std::vector<double> det() const;
+    std::vector<double> trace() const;
+
+    // Throws SingularMatrixException if any matrix has |det()| < EPS.
+    MatrixBatch inverse() const;
+
+private:
+    struct AlignedDelete {
+        void operator()(double* ptr) const;
+    };
+
+    // Matrices per chunk for operations touching `elements` values per matrix.
+    static size_t chunkSize(size_t elements);
+
+    std::pair<size_t, size_t> dim_size;
+    size_t matrices;
+    size_t lane_stride;
+    std::unique_ptr<double[], AlignedDelete> elements;
+};
+
+}  // namespace task
@@ -0,0 +1,426 @@
+#pragma once
+
+#include <algorithm>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+
+#include "matrix.h"
+#include "simd.h"
+#include "thread_pool.h"
+
+
+namespace task {
+
+namespace expr {
+
+// Element-wise arithmetic on matrices builds a tree of lazy nodes that is
+// evaluated when assigned to a Matrix. Evaluation walks the result tile by
+// tile: each node computes a tile of up to kTile elements with the SIMD
+// kernels, reading its operands' tiles while they are still in L1, so the
+// whole expression costs one pass over memory and no temporaries.
+//
+// Operands that are named matrices are held by reference, temporaries are
+// moved into the node. Sizes are checked when a node is built.
+//
+// Every node and leaf provides:
+//   shape()                 - dimensions;
+//   tile(row, col, n, out)  - pointer to elements [col, col + n) of `row`,
+//                             either into an operand or into `out` after
+//                             filling it;
+//   reads(begin, end)       - whether evaluation reads memory in [begin, end);
+//   contiguous()            - whether all leaves store rows back to back.
+
+const size_t kTile = 256;
+
+// Tiles per parallel chunk.
+const size_t kParallelTiles = 128;
+
+class Ref {
+public:
+    explicit Ref(const Matrix& matrix) : matrix(&matrix) {}
+
+    std::pair<size_t, size_t> shape() const {
+        return matrix->size();
+    }
+
+    const double* tile(size_t row, size_t col, size_t, double*) const {
+        return matrix->rawData() + row * matrix->stride() + col;
+    }
+
+    bool reads(const double* begin, const double* end) const {
+        const double* elements = matrix->rawData();
+        return elements < end && begin < elements + matrix->size().first * matrix->stride();
+    }
+
+    bool contiguous() const {
+        return matrix->stride() == matrix->size().second;
+    }
+
+private:
+    const Matrix* matrix;
+};
+
+class Value {
+public:
+    explicit Value(Matrix&& matrix) : matrix(std::move(matrix)) {}
+    explicit Value(const Matrix& matrix) : matrix(matrix) {}
+
+    std::pair<size_t, size_t> shape() const {
+        return matrix.size();
+    }
+
+    const double* tile(size_t row, size_t col, size_t, double*) const {
+        return matrix.rawData() + row * matrix.stride() + col;
+    }
+
+    bool reads(const double*, const double*) const {
+        return false;
+    }
+
+    bool contiguous() const {
+        return matrix.stride() == matrix.size().second;
+    }
+
+private:
+    Matrix matrix;
+};
+
+// How an operand deduced as T is stored inside a node.
+template <class T>
+struct Operand {
+    using type = std::decay_t<T>;
+};
+
+template <>
+struct Operand<Matrix&> {
+    using type = Ref;
+};
+
+template <>
+struct Operand<const Matrix&> {
+    using type = Ref;
+};
+
+template <>
+struct Operand<Matrix> {
+    using type = Value;
+};
+
+template <>
+struct Operand<const Matrix> {
+    using type = Value;
+};
+
+template <class T>
+using OperandType = typename Operand<T>::type;
+
+template <class T>
+struct IsOperand : std::integral_constant<bool,
+    std::is_same<std::decay_t<T>, Matrix>::value || std::is_base_of<Node, std::decay_t<T>>::value> {};
+
+template <class T>
+using EnableIfOperand = std::enable_if_t<IsOperand<T>::value>;
+
+// Both are operands and at least one is a node; Matrix-Matrix overloads are members.
+template <class L, class R>
+using EnableIfMixed = std::enable_if_t<IsOperand<L>::value && IsOperand<R>::value &&
+    (std::is_base_of<Node, std::decay_t<L>>::value || std::is_base_of<Node, std::decay_t<R>>::value)>;
+
+struct Add {
+    static void apply(const double* a, const double* b, double* out, size_t n) {
+        simd::add(a, b, out, n);
+    }
+};
+
+struct Sub {
+    static void apply(const double* a, const double* b, double* out, size_t n) {
+        simd::sub(a, b, out, n);
+    }
+};
+
+template <class Op, class L, class R>
+class Binary : public Node {
+public:
+    Binary(L lhs, R rhs) : lhs(std::move(lhs)), rhs(std::move(rhs)) {
+        if (this->lhs.shape() != this->rhs.shape()) {
+            throw SizeMismatchException();
+        }
+    }
+
+    std::pair<size_t, size_t> shape() const {
+        return lhs.shape();
+    }
+
+    const double* tile(size_t row, size_t col, size_t n, double* out) const {
+        double scratch[kTile];
+
+        const double* left = lhs.tile(row, col, n, out);
+        const double* right = rhs.tile(row, col, n, scratch);
+        Op::apply(left, right, out, n);
+
+        return out;
+    }
+
+    bool reads(const double* begin, const double* end) const {
+        return lhs.reads(begin, end) || rhs.reads(begin, end);
+    }
+
+    bool contiguous() const {
+        return lhs.contiguous() && rhs.contiguous();
+    }
+
+private:
+    L lhs;
+    R rhs;
+};
+
+template <class E>
+class Scaled : public Node {
+public:
+    Scaled(E operand, double factor) : operand(std::move(operand)), factor(factor) {}
+
+    std::pair<size_t, size_t> shape() const {
+        return operand.shape();
+    }
+
+    const double* tile(size_t row, size_t col, size_t n, double* out) const {
+        simd::scale(operand.tile(row, col, n, out), factor, out, n);
+        return out;
+    }
+
+    bool reads(const double* begin, const double* end) const {
+        return operand.reads(begin, end);
+    }
+
+    bool contiguous() const {
+        return operand.contiguous();
+    }
+
+private:
+    E operand;
+    double factor;
+};
+
+template <class E>
+class Negated : public Node {
+public:
+    explicit Negated(E operand) : operand(std::move(operand)) {}
+
+    std::pair<size_t, size_t> shape() const {
+        return operand.shape();
+    }
+
+    const double* tile(size_t row, size_t col, size_t n, double* out) const {
+        simd::negate(operand.tile(row, col, n, out), out, n);
+        return out;
+    }
+
+    bool reads(const double* begin, const double* end) const {
+        return operand.reads(begin, end);
+    }
+
+    bool contiguous() const {
+        return operand.contiguous();
+    }
+
+private:
+    E operand;
+};
+
+// Calls body(target, row, col, n) for every tile of `result`, where `target`
+// points at its elements and (row, col) is where operands read the tile.
+template <class E, class Body>
+void forEachTile(Matrix& result, const E& expression, const Body& body) {
+    size_t rows = result.size().first;
+    size_t cols = result.size().second;
+    size_t stride = result.stride();
+    double* elements = result.rawData();
+
+    // Unpadded operands can be walked as a single long row.
+    if (stride == cols && expression.contiguous()) {
+        cols *= rows;
+        rows = rows == 0 ? 0 : 1;
+    }
+
+    size_t tiles_per_row = (cols + kTile - 1) / kTile;
+    parallelFor(defaultExecutionPolicy(), 0, rows * tiles_per_row, kParallelTiles, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; ++t) {
+            size_t row = t / tiles_per_row;
+            size_t col = t % tiles_per_row * kTile;
+            body(elements + row * stride + col, row, col, std::min(kTile, cols - col));
+        }
+    });
+}
+
+// Writes `expression` into `result`, which must already have its size.
+template <class E>
+void evaluate(Matrix& result, const E& expression) {
+    // Writing straight into `result` would clobber elements that other
+    // leaves still have to read, so aliased tiles go through scratch. A leaf
+    // overlapping `result` has its size, so it reads the same positions.
+    double* elements = result.rawData();
+    bool aliased = expression.reads(elements, elements + result.size().first * result.stride());
+
+    forEachTile(result, expression, [&](double* target, size_t row, size_t col, size_t n) {
+        double scratch[kTile];
+
+        const double* values = expression.tile(row, col, n, aliased ? scratch : target);
+        if (values != target) {
+            std::copy_n(values, n, target);
+        }
+    });
+}
+
+// Computes result = Op(result, expression) in place. Each tile of
+// `expression` is finished in scratch before its target is written, so
+// operands aliasing `result` are read intact.
+template <class Op, class E>
+void update(Matrix& result, const E& expression) {
+    if (result.size() != expression.shape()) {
+        throw SizeMismatchException();
+    }
+
+    forEachTile(result, expression, [&](double* target, size_t row, size_t col, size_t n) {
+        double scratch[kTile];
+
+        Op::apply(target, expression.tile(row, col, n, scratch), target, n);
+    });
+}
+
+// Compares tile by tile without materializing either side.
+template <class L, class R>
+bool equal(const L& lhs, const R& rhs) {
+    if (lhs.shape() != rhs.shape()) {
+        throw SizeMismatchException();
+    }
+
+    size_t rows = lhs.shape().first;
+    size_t cols = lhs.shape().second;
+    double left_scratch[kTile];
+    double right_scratch[kTile];
+
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t col = 0; col < cols; col += kTile) {
+            size_t n = std::min(kTile, cols - col);
+
+            if (!simd::equal(lhs.tile(row, col, n, left_scratch), rhs.tile(row, col, n, right_scratch), n, EPS)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// Views an operand as a leaf or node without copying it.
+inline Ref borrow(const Matrix& matrix) {
+    return Ref(matrix);
+}
+
+template <class E>
+const E& borrow(const E& expression) {
+    return expression;
+}
+
+inline const Matrix& materialize(const Matrix& matrix) {
+    return matrix;
+}
+
+template <class E>
+Matrix materialize(const E& expression) {
+    return Matrix(expression);
+}
+
+template <class L, class R, class = EnableIfOperand<L>, class = EnableIfOperand<R>>
+Binary<Add, OperandType<L>, OperandType<R>> operator+(L&& lhs, R&& rhs) {
+    return { OperandType<L>(std::forward<L>(lhs)), OperandType<R>(std::forward<R>(rhs)) };
+}
+
+template <class L, class R, class = EnableIfOperand<L>, class = EnableIfOperand<R>>
+Binary<Sub, OperandType<L>, OperandType<R>> operator-(L&& lhs, R&& rhs) {
+    return { OperandType<L>(std::forward<L>(lhs)), OperandType<R>(std::forward<R>(rhs)) };
+}
+
+template <class E, class = EnableIfOperand<E>>
+Scaled<OperandType<E>> operator*(E&& operand, const double& factor) {
+    return { OperandType<E>(std::forward<E>(operand)), factor };
+}
+
+template <class E, class = EnableIfOperand<E>>
+Scaled<OperandType<E>> operator*(const double& factor, E&& operand) {
+    return { OperandType<E>(std::forward<E>(operand)), factor };
+}
+
+template <class E, class = EnableIfOperand<E>>
+Negated<OperandType<E>> operator-(E&& operand) {
+    return Negated<OperandType<E>>(OperandType<E>(std::forward<E>(operand)));
+}
+
+template <class E, class = EnableIfNode<E>>
+std::decay_t<E> operator+(E&& operand) {
+    return std::forward<E>(operand);
+}
+
+// Matrix products are not element-wise: node operands are evaluated first.
+template <class L, class R, class = EnableIfMixed<L, R>>
+Matrix operator*(const L& lhs, const R& rhs) {
+    return Matrix::multiply(materialize(lhs), materialize(rhs), defaultExecutionPolicy());
+}
+
+template <class L, class R, class = EnableIfMixed<L, R>>
+bool operator==(const L& lhs, const R& rhs) {
+    return equal(borrow(lhs), borrow(rhs));
+}
+
+template <class L, class R, class = EnableIfMixed<L, R>>
+bool operator!=(const L& lhs, const R& rhs) {
+    return !(lhs == rhs);
+}
+
+template <class E, class = EnableIfNode<E>>
+std::ostream& operator<<(std::ostream& output, const E& expression) {
+    return output << Matrix(expression);
+}
+
+}  // namespace expr
+
+// Found by argument-dependent lookup for Matrix operands; nodes find them in expr.
+using expr::operator+;
+using expr::operator-;
+using expr::operator*;
+using expr::operator==;
+using expr::operator!=;
+
+template <class E, class>
+Matrix::BasicMatrix(const E& expression)
+    : Matrix(expression.shape().first, expression.shape().second, Uninitialized()) {
+    expr::evaluate(*this, expression);
+}
+
+template <class E, class>
+Matrix& Matrix::operator=(const E& expression) {
+    if (this->dim_size != expression.shape()) {
+        Matrix result(expression.shape().first, expression.shape().second, Uninitialized(), 0, this->memory);
+        expr::evaluate(result, expression);
+        swap(result);
+    } else {
+        expr::evaluate(*this, expression);
+    }
+
+    return *this;
+}
+
+template <class E, class>
+Matrix& Matrix::operator+=(const E& expression) {
+    expr::update<expr::Add>(*this, expression);
+    return *this;
+}
+
+template <class E, class>
+Matrix& Matrix::operator-=(const E& expression) {
+    expr::update<expr::Sub>(*this, expression);
+    return *this;
+}
+
+}  // namespace task
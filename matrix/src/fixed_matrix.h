@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <limits>
+#include <ostream>
+#include <utility>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// R x C matrix of doubles stored inline, for the small transforms where a
+// heap allocation per Matrix would dominate the arithmetic. Everything but
+// the conversions to and from Matrix is constexpr, products are unrolled at
+// compile time and det() and inverse() are closed-form up to 4 x 4.
+//
+// Like Matrix, a default-constructed FixedMatrix has ones on the diagonal
+// and zeros elsewhere, and comparisons use EPS.
+template <size_t R, size_t C>
+class FixedMatrix {
+    static_assert(R > 0 && C > 0, "FixedMatrix dimensions must be positive");
+
+    template <size_t, size_t>
+    friend class FixedMatrix;
+
+public:
+    static constexpr size_t kRows = R;
+    static constexpr size_t kCols = C;
+
+    constexpr FixedMatrix();
+
+    // Row by row; throws SizeMismatchException unless there are R rows of C values.
+    constexpr FixedMatrix(std::initializer_list<std::initializer_list<double>> rows);
+
+    static constexpr FixedMatrix zero();
+
+    // Throw SizeMismatchException unless the source is R x C.
+    explicit FixedMatrix(const Matrix& matrix);
+    template <class T>
+    explicit FixedMatrix(const BasicMatrixView<T>& view);
+
+    Matrix toMatrix() const;
+
+    constexpr double* operator[](size_t row);
+    constexpr const double* operator[](size_t row) const;
+
+    constexpr double& get(size_t row, size_t col);
+    constexpr const double& get(size_t row, size_t col) const;
+    constexpr void set(size_t row, size_t col, const double& value);
+
+    constexpr FixedMatrix& operator+=(const FixedMatrix& a);
+    constexpr FixedMatrix& operator-=(const FixedMatrix& a);
+    constexpr FixedMatrix& operator*=(const double& number);
+
+    constexpr FixedMatrix operator+(const FixedMatrix& a) const;
+    constexpr FixedMatrix operator-(const FixedMatrix& a) const;
+    constexpr FixedMatrix operator*(const double& number) const;
+    constexpr FixedMatrix operator-() const;
+
+    template <size_t K>
+    constexpr FixedMatrix<R, K> operator*(const FixedMatrix<C, K>& a) const;
+
+    constexpr FixedMatrix<C, R> transposed() const;
+
+    // Square matrices only.
+    constexpr double trace() const;
+    constexpr double det() const;
+
+    // Throws SingularMatrixException if the determinant is within rounding
+    // error of zero, relative to the product of the row norms; det() is 0 in
+    // the same case.
+    constexpr FixedMatrix inverse() const;
+
+    constexpr bool operator==(const FixedMatrix& a) const;
+    constexpr bool operator!=(const FixedMatrix& a) const;
+
+    constexpr std::pair<size_t, size_t> size() const;
+
+private:
+    template <size_t K, size_t... I>
+    constexpr void multiplyInto(const FixedMatrix<C, K>& a, FixedMatrix<R, K>& result,
+                                std::index_sequence<I...>) const;
+
+    template <size_t K, size_t... J>
+    constexpr double dot(size_t row, size_t col, const FixedMatrix<C, K>& a,
+                         std::index_sequence<J...>) const;
+
+    constexpr bool negligible(double determinant) const;
+    constexpr double eliminatedDet() const;
+    constexpr FixedMatrix eliminatedInverse() const;
+
+    double elements[R][C];
+};
+
+template <size_t R, size_t C>
+constexpr FixedMatrix<R, C> operator*(const double& number, const FixedMatrix<R, C>& a);
+
+template <size_t R, size_t C>
+std::ostream& operator<<(std::ostream& output, const FixedMatrix<R, C>& matrix);
+
+using Matrix2 = FixedMatrix<2, 2>;
+using Matrix3 = FixedMatrix<3, 3>;
+using Matrix4 = FixedMatrix<4, 4>;
+
+}  // namespace task
+
+
+#include "fixed_matrix.tpp"
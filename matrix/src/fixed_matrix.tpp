@@ -0,0 +1,493 @@
+#include "fixed_matrix.h"
+
+namespace task {
+
+    namespace fixed {
+
+        // Products with more multiply-adds than this are left as loops.
+        constexpr size_t kUnrollLimit = 512;
+
+        constexpr double absolute(double value) {
+            return value < 0 ? -value : value;
+        }
+
+    }  // namespace fixed
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C>::FixedMatrix() : elements{} {
+        for (size_t i = 0; i < R && i < C; ++i) {
+            this->elements[i][i] = 1.;
+        }
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C>::FixedMatrix(std::initializer_list<std::initializer_list<double>> rows)
+        : elements{} {
+        if (rows.size() != R) {
+            throw SizeMismatchException();
+        }
+
+        size_t i = 0;
+        for (const auto& row : rows) {
+            if (row.size() != C) {
+                throw SizeMismatchException();
+            }
+
+            size_t j = 0;
+            for (double value : row) {
+                this->elements[i][j++] = value;
+            }
+            ++i;
+        }
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::zero() {
+        FixedMatrix result;
+        for (size_t i = 0; i < R && i < C; ++i) {
+            result.elements[i][i] = 0.;
+        }
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    FixedMatrix<R, C>::FixedMatrix(const Matrix& matrix) : FixedMatrix(matrix.view()) {}
+
+    template <size_t R, size_t C>
+    template <class T>
+    FixedMatrix<R, C>::FixedMatrix(const BasicMatrixView<T>& view) : elements{} {
+        if (view.shape() != std::make_pair(R, C)) {
+            throw SizeMismatchException();
+        }
+
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                this->elements[i][j] = view(i, j);
+            }
+        }
+    }
+
+    template <size_t R, size_t C>
+    Matrix FixedMatrix<R, C>::toMatrix() const {
+        Matrix result(R, C);
+        for (size_t i = 0; i < R; ++i) {
+            std::copy_n(this->elements[i], C, result.rawData() + i * result.stride());
+        }
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr double* FixedMatrix<R, C>::operator[](size_t row) {
+        return this->elements[row];
+    }
+
+    template <size_t R, size_t C>
+    constexpr const double* FixedMatrix<R, C>::operator[](size_t row) const {
+        return this->elements[row];
+    }
+
+    template <size_t R, size_t C>
+    constexpr double& FixedMatrix<R, C>::get(size_t row, size_t col) {
+        if (row >= R || col >= C) {
+            throw OutOfBoundsException();
+        }
+        return this->elements[row][col];
+    }
+
+    template <size_t R, size_t C>
+    constexpr const double& FixedMatrix<R, C>::get(size_t row, size_t col) const {
+        if (row >= R || col >= C) {
+            throw OutOfBoundsException();
+        }
+        return this->elements[row][col];
+    }
+
+    template <size_t R, size_t C>
+    constexpr void FixedMatrix<R, C>::set(size_t row, size_t col, const double& value) {
+        get(row, col) = value;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C>& FixedMatrix<R, C>::operator+=(const FixedMatrix& a) {
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                this->elements[i][j] += a.elements[i][j];
+            }
+        }
+        return *this;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C>& FixedMatrix<R, C>::operator-=(const FixedMatrix& a) {
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                this->elements[i][j] -= a.elements[i][j];
+            }
+        }
+        return *this;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C>& FixedMatrix<R, C>::operator*=(const double& number) {
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                this->elements[i][j] *= number;
+            }
+        }
+        return *this;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::operator+(const FixedMatrix& a) const {
+        FixedMatrix result = *this;
+        return result += a;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::operator-(const FixedMatrix& a) const {
+        FixedMatrix result = *this;
+        return result -= a;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::operator*(const double& number) const {
+        FixedMatrix result = *this;
+        return result *= number;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::operator-() const {
+        return *this * -1.;
+    }
+
+    template <size_t R, size_t C>
+    template <size_t K, size_t... J>
+    constexpr double FixedMatrix<R, C>::dot(size_t row, size_t col, const FixedMatrix<C, K>& a,
+                                            std::index_sequence<J...>) const {
+        return ((this->elements[row][J] * a.elements[J][col]) + ...);
+    }
+
+    template <size_t R, size_t C>
+    template <size_t K, size_t... I>
+    constexpr void FixedMatrix<R, C>::multiplyInto(const FixedMatrix<C, K>& a, FixedMatrix<R, K>& result,
+                                                   std::index_sequence<I...>) const {
+        ((result.elements[I / K][I % K] = dot(I / K, I % K, a, std::make_index_sequence<C>())), ...);
+    }
+
+    template <size_t R, size_t C>
+    template <size_t K>
+    constexpr FixedMatrix<R, K> FixedMatrix<R, C>::operator*(const FixedMatrix<C, K>& a) const {
+        FixedMatrix<R, K> result;
+
+        if constexpr (R * C * K <= fixed::kUnrollLimit) {
+            multiplyInto(a, result, std::make_index_sequence<R * K>());
+        } else {
+            for (size_t i = 0; i < R; ++i) {
+                for (size_t j = 0; j < K; ++j) {
+                    result.elements[i][j] = 0.;
+                }
+                for (size_t k = 0; k < C; ++k) {
+                    for (size_t j = 0; j < K; ++j) {
+                        result.elements[i][j] += this->elements[i][k] * a.elements[k][j];
+                    }
+                }
+            }
+        }
+
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<C, R> FixedMatrix<R, C>::transposed() const {
+        FixedMatrix<C, R> result;
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                result.elements[j][i] = this->elements[i][j];
+            }
+        }
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr double FixedMatrix<R, C>::trace() const {
+        static_assert(R == C, "trace() of a non-square FixedMatrix");
+
+        double result = 0.;
+        for (size_t i = 0; i < R; ++i) {
+            result += this->elements[i][i];
+        }
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr double FixedMatrix<R, C>::det() const {
+        static_assert(R == C, "det() of a non-square FixedMatrix");
+        const auto& a = this->elements;
+
+        double result = 0.;
+        if constexpr (R == 1) {
+            result = a[0][0];
+        } else if constexpr (R == 2) {
+            result = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        } else if constexpr (R == 3) {
+            result = a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) +
+                     a[0][1] * (a[1][2] * a[2][0] - a[1][0] * a[2][2]) +
+                     a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+        } else if constexpr (R == 4) {
+            // Laplace expansion by the 2 x 2 minors of the top and bottom rows.
+            double s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+            double s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+            double s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+            double s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+            double s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+            double s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+            double c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+            double c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+            double c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+            double c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+            double c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+            double c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+            result = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+        } else {
+            result = eliminatedDet();
+        }
+
+        return negligible(result) ? 0. : result;
+    }
+
+    // Whether a determinant of this matrix is within rounding error of zero:
+    // every closed form and elimination sums products bounded by the product
+    // of the row 1-norms, so the test is relative to that and uniformly
+    // scaling a matrix never changes whether it is singular.
+    template <size_t R, size_t C>
+    constexpr bool FixedMatrix<R, C>::negligible(double determinant) const {
+        double bound = 1.;
+        for (size_t i = 0; i < R; ++i) {
+            double norm = 0.;
+            for (size_t j = 0; j < C; ++j) {
+                norm += fixed::absolute(this->elements[i][j]);
+            }
+            bound *= norm;
+        }
+        return fixed::absolute(determinant) <= R * std::numeric_limits<double>::epsilon() * bound;
+    }
+
+    // Gaussian elimination with partial pivoting on a copy.
+    template <size_t R, size_t C>
+    constexpr double FixedMatrix<R, C>::eliminatedDet() const {
+        FixedMatrix a = *this;
+        double result = 1.;
+
+        for (size_t j = 0; j < R; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < R; ++i) {
+                if (fixed::absolute(a.elements[i][j]) > fixed::absolute(a.elements[pivot][j])) {
+                    pivot = i;
+                }
+            }
+
+            if (a.elements[pivot][j] == 0.) {
+                return 0.;
+            }
+            if (pivot != j) {
+                for (size_t k = 0; k < R; ++k) {
+                    double swapped = a.elements[j][k];
+                    a.elements[j][k] = a.elements[pivot][k];
+                    a.elements[pivot][k] = swapped;
+                }
+                result = -result;
+            }
+
+            result *= a.elements[j][j];
+            for (size_t i = j + 1; i < R; ++i) {
+                double factor = a.elements[i][j] / a.elements[j][j];
+                for (size_t k = j; k < R; ++k) {
+                    a.elements[i][k] -= factor * a.elements[j][k];
+                }
+            }
+        }
+
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::inverse() const {
+        static_assert(R == C, "inverse() of a non-square FixedMatrix");
+        const auto& a = this->elements;
+        FixedMatrix result;
+
+        // The closed forms divide by the determinant they compute anyway,
+        // after the same test as det() applies.
+        if constexpr (R == 1) {
+            if (negligible(a[0][0])) {
+                throw SingularMatrixException();
+            }
+            result.elements[0][0] = 1. / a[0][0];
+        } else if constexpr (R == 2) {
+            double d = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+            if (negligible(d)) {
+                throw SingularMatrixException();
+            }
+            result.elements[0][0] = a[1][1] / d;
+            result.elements[0][1] = -a[0][1] / d;
+            result.elements[1][0] = -a[1][0] / d;
+            result.elements[1][1] = a[0][0] / d;
+        } else if constexpr (R == 3) {
+            double c00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+            double c01 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+            double c02 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+            double d = a[0][0] * c00 + a[0][1] * c01 + a[0][2] * c02;
+            if (negligible(d)) {
+                throw SingularMatrixException();
+            }
+
+            // Transposed cofactors over the determinant.
+            result.elements[0][0] = c00 / d;
+            result.elements[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) / d;
+            result.elements[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) / d;
+            result.elements[1][0] = c01 / d;
+            result.elements[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) / d;
+            result.elements[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) / d;
+            result.elements[2][0] = c02 / d;
+            result.elements[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) / d;
+            result.elements[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) / d;
+        } else if constexpr (R == 4) {
+            double s0 = a[0][0] * a[1][1] - a[1][0] * a[0][1];
+            double s1 = a[0][0] * a[1][2] - a[1][0] * a[0][2];
+            double s2 = a[0][0] * a[1][3] - a[1][0] * a[0][3];
+            double s3 = a[0][1] * a[1][2] - a[1][1] * a[0][2];
+            double s4 = a[0][1] * a[1][3] - a[1][1] * a[0][3];
+            double s5 = a[0][2] * a[1][3] - a[1][2] * a[0][3];
+
+            double c5 = a[2][2] * a[3][3] - a[3][2] * a[2][3];
+            double c4 = a[2][1] * a[3][3] - a[3][1] * a[2][3];
+            double c3 = a[2][1] * a[3][2] - a[3][1] * a[2][2];
+            double c2 = a[2][0] * a[3][3] - a[3][0] * a[2][3];
+            double c1 = a[2][0] * a[3][2] - a[3][0] * a[2][2];
+            double c0 = a[2][0] * a[3][1] - a[3][0] * a[2][1];
+
+            double d = s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0;
+            if (negligible(d)) {
+                throw SingularMatrixException();
+            }
+
+            result.elements[0][0] = (a[1][1] * c5 - a[1][2] * c4 + a[1][3] * c3) / d;
+            result.elements[0][1] = (-a[0][1] * c5 + a[0][2] * c4 - a[0][3] * c3) / d;
+            result.elements[0][2] = (a[3][1] * s5 - a[3][2] * s4 + a[3][3] * s3) / d;
+            result.elements[0][3] = (-a[2][1] * s5 + a[2][2] * s4 - a[2][3] * s3) / d;
+
+            result.elements[1][0] = (-a[1][0] * c5 + a[1][2] * c2 - a[1][3] * c1) / d;
+            result.elements[1][1] = (a[0][0] * c5 - a[0][2] * c2 + a[0][3] * c1) / d;
+            result.elements[1][2] = (-a[3][0] * s5 + a[3][2] * s2 - a[3][3] * s1) / d;
+            result.elements[1][3] = (a[2][0] * s5 - a[2][2] * s2 + a[2][3] * s1) / d;
+
+            result.elements[2][0] = (a[1][0] * c4 - a[1][1] * c2 + a[1][3] * c0) / d;
+            result.elements[2][1] = (-a[0][0] * c4 + a[0][1] * c2 - a[0][3] * c0) / d;
+            result.elements[2][2] = (a[3][0] * s4 - a[3][1] * s2 + a[3][3] * s0) / d;
+            result.elements[2][3] = (-a[2][0] * s4 + a[2][1] * s2 - a[2][3] * s0) / d;
+
+            result.elements[3][0] = (-a[1][0] * c3 + a[1][1] * c1 - a[1][2] * c0) / d;
+            result.elements[3][1] = (a[0][0] * c3 - a[0][1] * c1 + a[0][2] * c0) / d;
+            result.elements[3][2] = (-a[3][0] * s3 + a[3][1] * s1 - a[3][2] * s0) / d;
+            result.elements[3][3] = (a[2][0] * s3 - a[2][1] * s1 + a[2][2] * s0) / d;
+        } else {
+            result = eliminatedInverse();
+        }
+
+        return result;
+    }
+
+    // Gauss-Jordan elimination with partial pivoting, applied to the
+    // identity. The product of the pivots is the determinant, which decides
+    // singularity as in det() without a second elimination.
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> FixedMatrix<R, C>::eliminatedInverse() const {
+        FixedMatrix a = *this;
+        FixedMatrix result;
+        double determinant = 1.;
+
+        for (size_t j = 0; j < R; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < R; ++i) {
+                if (fixed::absolute(a.elements[i][j]) > fixed::absolute(a.elements[pivot][j])) {
+                    pivot = i;
+                }
+            }
+
+            if (a.elements[pivot][j] == 0.) {
+                throw SingularMatrixException();
+            }
+            if (pivot != j) {
+                determinant = -determinant;
+            }
+            for (size_t k = 0; k < R; ++k) {
+                double swapped = a.elements[j][k];
+                a.elements[j][k] = a.elements[pivot][k];
+                a.elements[pivot][k] = swapped;
+
+                swapped = result.elements[j][k];
+                result.elements[j][k] = result.elements[pivot][k];
+                result.elements[pivot][k] = swapped;
+            }
+
+            double diagonal = a.elements[j][j];
+            determinant *= diagonal;
+            for (size_t k = 0; k < R; ++k) {
+                a.elements[j][k] /= diagonal;
+                result.elements[j][k] /= diagonal;
+            }
+
+            for (size_t i = 0; i < R; ++i) {
+                if (i == j) {
+                    continue;
+                }
+
+                double factor = a.elements[i][j];
+                for (size_t k = 0; k < R; ++k) {
+                    a.elements[i][k] -= factor * a.elements[j][k];
+                    result.elements[i][k] -= factor * result.elements[j][k];
+                }
+            }
+        }
+
+        if (negligible(determinant)) {
+            throw SingularMatrixException();
+        }
+        return result;
+    }
+
+    template <size_t R, size_t C>
+    constexpr bool FixedMatrix<R, C>::operator==(const FixedMatrix& a) const {
+        for (size_t i = 0; i < R; ++i) {
+            for (size_t j = 0; j < C; ++j) {
+                if (fixed::absolute(this->elements[i][j] - a.elements[i][j]) >= EPS) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    template <size_t R, size_t C>
+    constexpr bool FixedMatrix<R, C>::operator!=(const FixedMatrix& a) const {
+        return !(*this == a);
+    }
+
+    template <size_t R, size_t C>
+    constexpr std::pair<size_t, size_t> FixedMatrix<R, C>::size() const {
+        return { R, C };
+    }
+
+    template <size_t R, size_t C>
+    constexpr FixedMatrix<R, C> operator*(const double& number, const FixedMatrix<R, C>& a) {
+        return a * number;
+    }
+
+    template <size_t R, size_t C>
+    std::ostream& operator<<(std::ostream& output, const FixedMatrix<R, C>& matrix) {
+        return output << matrix.toMatrix();
+    }
+
+}  // namespace task
@@ -0,0 +1,407 @@
+#include "gemm.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace task {
+
+    namespace {
+
+        // Micro-tile held in registers: kMr x kNr accumulators.
+        const size_t kMr = 4;
+        const size_t kNr = 8;
+
+        // kMc x kKc panel of A stays in L2, kKc x kNr sliver of B in L1,
+        // kKc x kNc panel of B in L3.
+        const size_t kMc = 96;
+        const size_t kKc = 256;
+        const size_t kNc = 2048;
+
+        // Below this many multiply-adds packing costs more than it saves.
+        const size_t kBlockedThreshold = 32 * 32 * 32;
+
+        // Multiply-adds per parallel slab.
+        const size_t kParallelFlops = 1 << 21;
+
+        // Columns of y per block in gemvTransposed(), so that the block of y
+        // stays in L1 while rows of A stream past it.
+        const size_t kGemvColumns = 1024;
+
+        std::atomic<GemmKernel> current_kernel(GemmKernel::kAuto);
+
+        struct AlignedDelete {
+            void operator()(double* ptr) const {
+                ::operator delete(static_cast<void*>(ptr), std::align_val_t(64));
+            }
+        };
+
+        using PackBuffer = std::unique_ptr<double[], AlignedDelete>;
+
+        PackBuffer allocatePackBuffer(size_t size) {
+            return PackBuffer(static_cast<double*>(::operator new(size * sizeof(double), std::align_val_t(64))));
+        }
+
+        double* packBufferA() {
+            thread_local PackBuffer buffer = allocatePackBuffer(kMc * kKc);
+            return buffer.get();
+        }
+
+        double* packBufferB() {
+            thread_local PackBuffer buffer = allocatePackBuffer(kKc * kNc);
+            return buffer.get();
+        }
+
+        // Stores an mc x kc block of A as kMr-row slivers, column by column,
+        // zero-padding the last sliver.
+        void packA(size_t mc, size_t kc, const double* a, size_t lda, double* packed) {
+            for (size_t ir = 0; ir < mc; ir += kMr) {
+                size_t mr = std::min(kMr, mc - ir);
+
+                for (size_t p = 0; p < kc; ++p) {
+                    for (size_t i = 0; i < mr; ++i) {
+                        packed[i] = a[(ir + i) * lda + p];
+                    }
+                    for (size_t i = mr; i < kMr; ++i) {
+                        packed[i] = 0.0;
+                    }
+                    packed += kMr;
+                }
+            }
+        }
+
+        // Stores a kc x nc block of B as kNr-column slivers, row by row,
+        // zero-padding the last sliver.
+        void packB(size_t kc, size_t nc, const double* b, size_t ldb, double* packed) {
+            for (size_t jr = 0; jr < nc; jr += kNr) {
+                size_t nr = std::min(kNr, nc - jr);
+
+                for (size_t p = 0; p < kc; ++p) {
+                    const double* row = b + p * ldb + jr;
+
+                    for (size_t j = 0; j < nr; ++j) {
+                        packed[j] = row[j];
+                    }
+                    for (size_t j = nr; j < kNr; ++j) {
+                        packed[j] = 0.0;
+                    }
+                    packed += kNr;
+                }
+            }
+        }
+
+        // C[0:mr, 0:nr] (+)= packed A sliver * packed B sliver.
+        void microKernel(size_t kc, const double* a, const double* b,
+                         double* c, size_t ldc, size_t mr, size_t nr, bool accumulate) {
+            double acc[kMr][kNr] = {};
+
+            for (size_t p = 0; p < kc; ++p) {
+                for (size_t i = 0; i < kMr; ++i) {
+                    double a_ip = a[i];
+
+                    for (size_t j = 0; j < kNr; ++j) {
+                        acc[i][j] += a_ip * b[j];
+                    }
+                }
+
+                a += kMr;
+                b += kNr;
+            }
+
+            for (size_t i = 0; i < mr; ++i) {
+                double* row = c + i * ldc;
+
+                if (accumulate) {
+                    for (size_t j = 0; j < nr; ++j) {
+                        row[j] += acc[i][j];
+                    }
+                } else {
+                    for (size_t j = 0; j < nr; ++j) {
+                        row[j] = acc[i][j];
+                    }
+                }
+            }
+        }
+
+        // out = x + y, or x - y, over a rows x cols block; out may alias x or y.
+        void addBlocks(size_t rows, size_t cols,
+                       const double* x, size_t ldx,
+                       const double* y, size_t ldy,
+                       double* out, size_t ldo, bool subtract) {
+            for (size_t i = 0; i < rows; ++i) {
+                if (subtract) {
+                    simd::sub(x + i * ldx, y + i * ldy, out + i * ldo, cols);
+                } else {
+                    simd::add(x + i * ldx, y + i * ldy, out + i * ldo, cols);
+                }
+            }
+        }
+
+        // The blocked kernel in slabs of rows of C, as in gemm::multiply().
+        void blockedSlabs(size_t m, size_t n, size_t k,
+                          const double* a, size_t lda,
+                          const double* b, size_t ldb,
+                          double* c, size_t ldc,
+                          ExecutionPolicy policy) {
+            size_t grain = std::max(kMc, kParallelFlops / (n * k + 1));
+            parallelFor(policy, 0, m, grain, [&](size_t begin, size_t end) {
+                gemm::blocked(end - begin, n, k, a + begin * lda, lda, b, ldb, c + begin * ldc, ldc);
+            });
+        }
+
+        // Winograd's variant with the schedule of Douglas et al., which needs
+        // three temporaries per level: X for sums of A quadrants, Y for sums
+        // of B quadrants and Z for P1 = A11 * B11, while the other products
+        // are accumulated in the quadrants of C.
+        void winograd(size_t m, size_t n, size_t k,
+                      const double* a, size_t lda,
+                      const double* b, size_t ldb,
+                      double* c, size_t ldc,
+                      size_t cutoff, ExecutionPolicy policy) {
+            if (std::min({ m, n, k }) <= std::max<size_t>(cutoff, 1)) {
+                blockedSlabs(m, n, k, a, lda, b, ldb, c, ldc, policy);
+                return;
+            }
+
+            size_t m2 = m / 2, n2 = n / 2, k2 = k / 2;
+
+            const double* a11 = a;
+            const double* a12 = a + k2;
+            const double* a21 = a + m2 * lda;
+            const double* a22 = a21 + k2;
+            const double* b11 = b;
+            const double* b12 = b + n2;
+            const double* b21 = b + k2 * ldb;
+            const double* b22 = b21 + n2;
+            double* c11 = c;
+            double* c12 = c + n2;
+            double* c21 = c + m2 * ldc;
+            double* c22 = c21 + n2;
+
+            PackBuffer x_buffer = allocatePackBuffer(m2 * k2);
+            PackBuffer y_buffer = allocatePackBuffer(k2 * n2);
+            PackBuffer z_buffer = allocatePackBuffer(m2 * n2);
+            double* x = x_buffer.get();
+            double* y = y_buffer.get();
+            double* z = z_buffer.get();
+
+            auto product = [&](const double* lhs, size_t ldl, const double* rhs, size_t ldr, double* out, size_t ldo) {
+                winograd(m2, n2, k2, lhs, ldl, rhs, ldr, out, ldo, cutoff, policy);
+            };
+
+            // C21 = P7 = (A11 - A21)(B22 - B12)
+            addBlocks(m2, k2, a11, lda, a21, lda, x, k2, true);
+            addBlocks(k2, n2, b22, ldb, b12, ldb, y, n2, true);
+            product(x, k2, y, n2, c21, ldc);
+
+            // C22 = P5 = (A21 + A22)(B12 - B11)
+            addBlocks(m2, k2, a21, lda, a22, lda, x, k2, false);
+            addBlocks(k2, n2, b12, ldb, b11, ldb, y, n2, true);
+            product(x, k2, y, n2, c22, ldc);
+
+            // C12 = P6 = (A21 + A22 - A11)(B22 - B12 + B11)
+            addBlocks(m2, k2, x, k2, a11, lda, x, k2, true);
+            addBlocks(k2, n2, b22, ldb, y, n2, y, n2, true);
+            product(x, k2, y, n2, c12, ldc);
+
+            // C11 = P3 = (A12 - A21 - A22 + A11) B22
+            addBlocks(m2, k2, a12, lda, x, k2, x, k2, true);
+            product(x, k2, b22, ldb, c11, ldc);
+
+            // Z = P1 = A11 B11
+            product(a11, lda, b11, ldb, z, n2);
+
+            // C12 = P1 + P6 + P5 + P3, C21 = P1 + P6 + P7, C22 = P1 + P6 + P7 + P5
+            addBlocks(m2, n2, z, n2, c12, ldc, c12, ldc, false);
+            addBlocks(m2, n2, c12, ldc, c21, ldc, c21, ldc, false);
+            addBlocks(m2, n2, c12, ldc, c22, ldc, c12, ldc, false);
+            addBlocks(m2, n2, c21, ldc, c22, ldc, c22, ldc, false);
+            addBlocks(m2, n2, c12, ldc, c11, ldc, c12, ldc, false);
+
+            // C21 -= P4 = A22 (B22 - B12 + B11 - B21)
+            addBlocks(k2, n2, y, n2, b21, ldb, y, n2, true);
+            product(a22, lda, y, n2, c11, ldc);
+            addBlocks(m2, n2, c21, ldc, c11, ldc, c21, ldc, true);
+
+            // C11 = P1 + P2 = A11 B11 + A12 B21
+            product(a12, lda, b21, ldb, c11, ldc);
+            addBlocks(m2, n2, z, n2, c11, ldc, c11, ldc, false);
+
+            // Peel the odd last row, column and inner index.
+            size_t even_m = 2 * m2, even_n = 2 * n2;
+
+            if (k % 2 != 0) {
+                const double* last_row = b + (k - 1) * ldb;
+                for (size_t i = 0; i < even_m; ++i) {
+                    simd::axpy(a[i * lda + k - 1], last_row, c + i * ldc, even_n);
+                }
+            }
+
+            if (n % 2 != 0) {
+                std::vector<double> column(k);
+                for (size_t p = 0; p < k; ++p) {
+                    column[p] = b[p * ldb + n - 1];
+                }
+                gemm::naive(m, 1, k, a, lda, column.data(), 1, c + n - 1, ldc);
+            }
+
+            if (m % 2 != 0) {
+                double* row = c + (m - 1) * ldc;
+                std::fill_n(row, even_n, 0.0);
+                for (size_t p = 0; p < k; ++p) {
+                    simd::axpy(a[(m - 1) * lda + p], b + p * ldb, row, even_n);
+                }
+            }
+        }
+
+    }  // namespace
+
+    void setGemmKernel(GemmKernel kernel) {
+        current_kernel.store(kernel, std::memory_order_relaxed);
+    }
+
+    GemmKernel gemmKernel() {
+        return current_kernel.load(std::memory_order_relaxed);
+    }
+
+    namespace gemm {
+
+        void naive(size_t m, size_t n, size_t k,
+                   const double* a, size_t lda,
+                   const double* b, size_t ldb,
+                   double* c, size_t ldc) {
+            for (size_t i = 0; i < m; ++i) {
+                for (size_t j = 0; j < n; ++j) {
+                    double sum = 0.0;
+
+                    for (size_t p = 0; p < k; ++p) {
+                        sum += a[i * lda + p] * b[p * ldb + j];
+                    }
+
+                    c[i * ldc + j] = sum;
+                }
+            }
+        }
+
+        void blocked(size_t m, size_t n, size_t k,
+                     const double* a, size_t lda,
+                     const double* b, size_t ldb,
+                     double* c, size_t ldc) {
+            if (k == 0) {
+                for (size_t i = 0; i < m; ++i) {
+                    std::fill_n(c + i * ldc, n, 0.0);
+                }
+                return;
+            }
+
+            double* packed_a = packBufferA();
+            double* packed_b = packBufferB();
+
+            for (size_t jc = 0; jc < n; jc += kNc) {
+                size_t nc = std::min(kNc, n - jc);
+
+                for (size_t pc = 0; pc < k; pc += kKc) {
+                    size_t kc = std::min(kKc, k - pc);
+                    bool accumulate = pc != 0;
+
+                    packB(kc, nc, b + pc * ldb + jc, ldb, packed_b);
+
+                    for (size_t ic = 0; ic < m; ic += kMc) {
+                        size_t mc = std::min(kMc, m - ic);
+
+                        packA(mc, kc, a + ic * lda + pc, lda, packed_a);
+
+                        for (size_t jr = 0; jr < nc; jr += kNr) {
+                            for (size_t ir = 0; ir < mc; ir += kMr) {
+                                microKernel(kc, packed_a + ir * kc, packed_b + jr * kc,
+                                            c + (ic + ir) * ldc + jc + jr, ldc,
+                                            std::min(kMr, mc - ir), std::min(kNr, nc - jr), accumulate);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        void strassen(size_t m, size_t n, size_t k,
+                      const double* a, size_t lda,
+                      const double* b, size_t ldb,
+                      double* c, size_t ldc,
+                      size_t cutoff, ExecutionPolicy policy) {
+            winograd(m, n, k, a, lda, b, ldb, c, ldc, cutoff, policy);
+        }
+
+        void multiply(size_t m, size_t n, size_t k,
+                      const double* a, size_t lda,
+                      const double* b, size_t ldb,
+                      double* c, size_t ldc,
+                      ExecutionPolicy policy) {
+            GemmKernel kernel = gemmKernel();
+            if (kernel == GemmKernel::kAuto) {
+                kernel = m * n * k < kBlockedThreshold ? GemmKernel::kNaive : GemmKernel::kBlocked;
+            }
+
+            if (kernel == GemmKernel::kStrassen) {
+                strassen(m, n, k, a, lda, b, ldb, c, ldc, kStrassenCutoff, policy);
+                return;
+            }
+
+            auto slab = [&](size_t begin, size_t end) {
+                if (kernel == GemmKernel::kNaive) {
+                    naive(end - begin, n, k, a + begin * lda, lda, b, ldb, c + begin * ldc, ldc);
+                } else {
+                    blocked(end - begin, n, k, a + begin * lda, lda, b, ldb, c + begin * ldc, ldc);
+                }
+            };
+
+            // Every slab repacks B, so slabs must be tall enough to amortize it.
+            size_t grain = std::max(kMc, kParallelFlops / (n * k + 1));
+            parallelFor(policy, 0, m, grain, slab);
+        }
+
+        void gemv(size_t m, size_t n,
+                  const double* a, size_t lda,
+                  const double* x, double* y,
+                  ExecutionPolicy policy) {
+            parallelFor(policy, 0, m, std::max<size_t>(1, kParallelFlops / (n + 1)), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    y[i] = simd::dot(a + i * lda, x, n);
+                }
+            });
+        }
+
+        // Every thread owns a range of y and sweeps all rows of A over it.
+        void gemvTransposed(size_t m, size_t n,
+                            const double* a, size_t lda,
+                            const double* x, double* y,
+                            ExecutionPolicy policy) {
+            size_t grain = std::max(kGemvColumns, kParallelFlops / (m + 1));
+            parallelFor(policy, 0, n, grain, [&](size_t begin, size_t end) {
+                for (size_t block = begin; block < end; block += kGemvColumns) {
+                    size_t len = std::min(kGemvColumns, end - block);
+                    std::fill_n(y + block, len, 0.0);
+
+                    for (size_t i = 0; i < m; ++i) {
+                        simd::axpy(x[i], a + i * lda + block, y + block, len);
+                    }
+                }
+            });
+        }
+
+        void rank1Update(size_t m, size_t n, double alpha,
+                         const double* x, const double* y,
+                         double* a, size_t lda,
+                         ExecutionPolicy policy) {
+            parallelFor(policy, 0, m, std::max<size_t>(1, kParallelFlops / (n + 1)), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    simd::axpy(alpha * x[i], y, a + i * lda, n);
+                }
+            });
+        }
+
+    }  // namespace gemm
+
+}  // namespace task
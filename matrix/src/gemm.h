@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+
+#include "thread_pool.h"
+
+
+namespace task {
+
+enum class GemmKernel {
+    kAuto,     // blocked kernel, except for products too small to amortize packing
+    kNaive,    // textbook i-j-k triple loop
+    kBlocked,  // cache-blocked kernel with packed panels and a register-tiled micro-kernel
+    kStrassen, // Strassen-Winograd recursion over the blocked kernel; never chosen by kAuto
+};
+
+// Selects the kernel used by Matrix::operator* for all subsequent products.
+void setGemmKernel(GemmKernel kernel);
+GemmKernel gemmKernel();
+
+namespace gemm {
+
+// All kernels compute C = A * B for row-major A (m x k), B (k x n) and C (m x n),
+// where lda, ldb and ldc are the row strides in elements. C must not alias A or B.
+void naive(size_t m, size_t n, size_t k,
+           const double* a, size_t lda,
+           const double* b, size_t ldb,
+           double* c, size_t ldc);
+
+void blocked(size_t m, size_t n, size_t k,
+             const double* a, size_t lda,
+             const double* b, size_t ldb,
+             double* c, size_t ldc);
+
+// Below this size in any dimension strassen() hands off to the blocked kernel.
+const size_t kStrassenCutoff = 256;
+
+// Strassen-Winograd: 7 half-size products and 15 additions per level instead
+// of 8 products, down to `cutoff`. Odd dimensions are peeled off and handled
+// by thin classic products. The error bound grows by a constant factor per
+// level, so results match the classic kernels to a looser tolerance than
+// they match each other. Needs O(m * k + k * n + m * n) scratch memory.
+void strassen(size_t m, size_t n, size_t k,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc,
+              size_t cutoff = kStrassenCutoff,
+              ExecutionPolicy policy = ExecutionPolicy::kSequential);
+
+// Runs the kernel chosen by setGemmKernel(). Under kParallel large products
+// are split into slabs of rows of C, one kernel call per slab.
+void multiply(size_t m, size_t n, size_t k,
+              const double* a, size_t lda,
+              const double* b, size_t ldb,
+              double* c, size_t ldc,
+              ExecutionPolicy policy = ExecutionPolicy::kSequential);
+
+// Level-2 kernels over the same row-major A (m x n) with row stride lda.
+// Vectors are contiguous and must not alias A or each other. Under kParallel
+// large matrices are split between threads; results do not depend on it.
+
+// y = A * x, where x has n elements and y has m.
+void gemv(size_t m, size_t n,
+          const double* a, size_t lda,
+          const double* x, double* y,
+          ExecutionPolicy policy = ExecutionPolicy::kSequential);
+
+// y = A^T * x, where x has m elements and y has n. Reads A by rows, so it
+// costs the same as gemv() and needs no transposed copy.
+void gemvTransposed(size_t m, size_t n,
+                    const double* a, size_t lda,
+                    const double* x, double* y,
+                    ExecutionPolicy policy = ExecutionPolicy::kSequential);
+
+// A += alpha * x * y^T, where x has m elements and y has n.
+void rank1Update(size_t m, size_t n, double alpha,
+                 const double* x, const double* y,
+                 double* a, size_t lda,
+                 ExecutionPolicy policy = ExecutionPolicy::kSequential);
+
+}  // namespace gemm
+
+}  // namespace task
@@ -0,0 +1,209 @@
+#include "lu.h"
+#include "gemm.h"
+#include "simd.h"
+
+#include <numeric>
+
+namespace task {
+
+    namespace {
+
+        // Panel width of the blocked right-looking factorization; matrices
+        // up to this size are factorized as a single panel.
+        const size_t kPanel = 64;
+
+    }  // namespace
+
+    LU::LU(const Matrix& a) : LU(Matrix(a)) {}
+
+    LU::LU(Matrix&& a) : lu(std::move(a)), odd_swaps(false), singular(false) {
+        if (this->lu.size().first != this->lu.size().second) {
+            throw SizeMismatchException();
+        }
+
+        factorize();
+    }
+
+    size_t LU::size() const {
+        return this->lu.size().first;
+    }
+
+    bool LU::isSingular() const {
+        return this->singular;
+    }
+
+    const Matrix& LU::factors() const {
+        return this->lu;
+    }
+
+    const std::vector<size_t>& LU::permutation() const {
+        return this->rows;
+    }
+
+    void LU::factorize() {
+        size_t n = size();
+        double* a = this->lu.rawData();
+        size_t lda = this->lu.stride();
+
+        this->rows.resize(n);
+        std::iota(this->rows.begin(), this->rows.end(), 0);
+
+        // Scratch for the trailing update, sized for the first (largest) one.
+        Matrix update(n > kPanel ? n - kPanel : 0, n > kPanel ? n - kPanel : 0);
+
+        for (size_t first = 0; first < n; first += kPanel) {
+            size_t width = std::min(kPanel, n - first);
+            size_t next = first + width;
+            size_t rest = n - next;
+
+            factorizePanel(first, width);
+
+            if (rest == 0) {
+                break;
+            }
+
+            // U12 = L11^-1 * A12
+            for (size_t i = first + 1; i < next; ++i) {
+                for (size_t r = first; r < i; ++r) {
+                    simd::axpy(-a[i * lda + r], a + r * lda + next, a + i * lda + next, rest);
+                }
+            }
+
+            // A22 -= L21 * U12
+            gemm::multiply(rest, rest, width,
+                           a + next * lda + first, lda,
+                           a + first * lda + next, lda,
+                           update.rawData(), update.stride(), defaultExecutionPolicy());
+
+            for (size_t i = 0; i < rest; ++i) {
+                double* row = a + (next + i) * lda + next;
+                simd::sub(row, update.rawData() + i * update.stride(), row, rest);
+            }
+        }
+    }
+
+    // Unblocked elimination of columns [first, first + width), updating only
+    // those columns; row swaps are applied to whole rows.
+    void LU::factorizePanel(size_t first, size_t width) {
+        size_t n = size();
+        double* a = this->lu.rawData();
+        size_t lda = this->lu.stride();
+
+        for (size_t j = first; j < first + width; ++j) {
+            size_t pivot = j;
+            for (size_t i = j + 1; i < n; ++i) {
+                if (fabs(a[i * lda + j]) > fabs(a[pivot * lda + j])) {
+                    pivot = i;
+                }
+            }
+
+            if (pivot != j) {
+                std::swap_ranges(a + j * lda, a + j * lda + n, a + pivot * lda);
+                std::swap(this->rows[j], this->rows[pivot]);
+                this->odd_swaps = !this->odd_swaps;
+            }
+
+            double diagonal = a[j * lda + j];
+            if (fabs(diagonal) < EPS) {
+                this->singular = true;
+            }
+            if (diagonal == 0.0) {
+                continue;
+            }
+
+            for (size_t i = j + 1; i < n; ++i) {
+                double* row = a + i * lda;
+                row[j] /= diagonal;
+                simd::axpy(-row[j], a + j * lda + j + 1, row + j + 1, first + width - j - 1);
+            }
+        }
+    }
+
+    double LU::det() const {
+        if (this->singular) {
+            return 0.0;
+        }
+        return determinant().value();
+    }
+
+    // A zero pivot makes the mantissa zero for good, so no threshold is
+    // needed here.
+    Determinant LU::determinant() const {
+        Determinant result{ this->odd_swaps ? -0.5 : 0.5, 1 };
+        const double* a = this->lu.rawData();
+        size_t lda = this->lu.stride();
+
+        for (size_t i = 0; i < size(); ++i) {
+            int exponent;
+            result.mantissa = std::frexp(result.mantissa * a[i * lda + i], &exponent);
+            result.exponent += exponent;
+        }
+
+        return result;
+    }
+
+    // Forward and back substitution on rows of x, already permuted.
+    void LU::solveInPlace(double* x, size_t ldx, size_t cols) const {
+        size_t n = size();
+        const double* a = this->lu.rawData();
+        size_t lda = this->lu.stride();
+
+        for (size_t i = 1; i < n; ++i) {
+            for (size_t r = 0; r < i; ++r) {
+                simd::axpy(-a[i * lda + r], x + r * ldx, x + i * ldx, cols);
+            }
+        }
+
+        for (size_t i = n; i-- > 0;) {
+            for (size_t r = i + 1; r < n; ++r) {
+                simd::axpy(-a[i * lda + r], x + r * ldx, x + i * ldx, cols);
+            }
+
+            double diagonal = a[i * lda + i];
+            for (size_t c = 0; c < cols; ++c) {
+                x[i * ldx + c] /= diagonal;
+            }
+        }
+    }
+
+    Matrix LU::solve(const Matrix& b) const {
+        if (b.size().first != size()) {
+            throw SizeMismatchException();
+        }
+        if (this->singular) {
+            throw SingularMatrixException();
+        }
+
+        size_t cols = b.size().second;
+        Matrix x(size(), cols);
+
+        for (size_t i = 0; i < size(); ++i) {
+            std::copy_n(b.rawData() + this->rows[i] * b.stride(), cols, x.rawData() + i * x.stride());
+        }
+
+        solveInPlace(x.rawData(), x.stride(), cols);
+        return x;
+    }
+
+    std::vector<double> LU::solve(const std::vector<double>& b) const {
+        if (b.size() != size()) {
+            throw SizeMismatchException();
+        }
+        if (this->singular) {
+            throw SingularMatrixException();
+        }
+
+        std::vector<double> x(size());
+        for (size_t i = 0; i < size(); ++i) {
+            x[i] = b[this->rows[i]];
+        }
+
+        solveInPlace(x.data(), 1, 1);
+        return x;
+    }
+
+    Matrix LU::inverse() const {
+        return solve(Matrix(size(), size()));
+    }
+
+}  // namespace task
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// LU factorization with partial pivoting, PA = LU. The factors are computed
+// once and reused by det(), solve() and inverse().
+class LU {
+public:
+    // Throws SizeMismatchException if `a` is not square.
+    explicit LU(const Matrix& a);
+    explicit LU(Matrix&& a);
+
+    size_t size() const;
+
+    // A pivot smaller than EPS in magnitude, as in Matrix::det().
+    bool isSingular() const;
+
+    // Product of the pivots, accumulated as a mantissa and a binary exponent
+    // so that no intermediate product overflows or underflows. determinant()
+    // is zero only for an exactly zero pivot, so it holds for matrices of any
+    // scale; det() is determinant().value(), or 0 if isSingular().
+    double det() const;
+    Determinant determinant() const;
+
+    // Solves AX = B for every column of B. Throw SizeMismatchException if B
+    // has a different number of rows and SingularMatrixException if A is singular.
+    Matrix solve(const Matrix& b) const;
+    std::vector<double> solve(const std::vector<double>& b) const;
+    Matrix inverse() const;
+
+    // Unit lower triangle L below the diagonal and U on and above it.
+    const Matrix& factors() const;
+
+    // Row i of PA is row permutation()[i] of A.
+    const std::vector<size_t>& permutation() const;
+
+private:
+    void factorize();
+    void factorizePanel(size_t first, size_t width);
+    void solveInPlace(double* x, size_t ldx, size_t cols) const;
+
+    Matrix lu;
+    std::vector<size_t> rows;
+    bool odd_swaps;
+    bool singular;
+};
+
+}  // namespace task
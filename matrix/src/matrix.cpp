@@ -1,7 +1,40 @@
 #include "matrix.h"
+#include "gemm.h"
+#include "lu.h"
+#include "serialization.h"
+#include "simd.h"
+
+#include <atomic>
+#include <limits>
 
 namespace task {
 
+    namespace {
+
+        // Elements per parallel chunk; smaller operations stay on one thread.
+        const size_t kParallelGrain = 1 << 15;
+
+        // 32 x 32 doubles: a source and a target tile fit in L1 together.
+        const size_t kTransposeTile = 32;
+
+        // a * b, throwing std::bad_array_new_length, as new[] would, if it
+        // does not fit in a size_t.
+        size_t checkedMultiply(size_t a, size_t b) {
+            if (b != 0 && a > std::numeric_limits<size_t>::max() / b) {
+                throw std::bad_array_new_length();
+            }
+            return a * b;
+        }
+
+        size_t checkedAdd(size_t a, size_t b) {
+            if (a > std::numeric_limits<size_t>::max() - b) {
+                throw std::bad_array_new_length();
+            }
+            return a + b;
+        }
+
+    }  // namespace
+
     double& Row::operator[](size_t col) {
         return this->data[col];
     }
@@ -14,105 +47,131 @@ namespace task {
         return this->size_;
     }
 
-    Row::Row(const Row& copy) {
-        this->data = new double[copy.size()];
-        this->size_ = copy.size();
-
-        for (size_t i = 0; i < this->size_; ++i) {
-            this->data[i] = copy.data[i];
-        }
+    Row::Row(const Row& copy) : size_(copy.size_), data(new double[copy.size_]), owner(true) {
+        std::copy_n(copy.data, this->size_, this->data);
     }
 
     Row::~Row() {
-        delete[] this->data;
+        if (this->owner) {
+            delete[] this->data;
+        }
     }
 
-    Row::Row() {
-        this->data = new double[1];
-        this->data[0] = 0.0;
-        this->size_ = 1;
-    }
+    Row::Row(double* data, size_t size) : size_(size), data(data), owner(false) {}
 
-    Row::Row(size_t size) {
-        this->data = new double[size];
+    size_t Matrix::paddedStride(size_t cols) {
+        const size_t line = kAlignment / sizeof(double);
 
-        for (size_t i = 0; i < size; ++i) {
-            this->data[i] = 0.0;
+        // Padding narrow rows would waste more memory than it saves in
+        // split cache lines, so only rows of 8+ cache lines are padded.
+        if (cols < 8 * line) {
+            return cols;
         }
 
-        this->size_ = size;
+        return checkedAdd(cols, line - 1) / line * line;
     }
 
-    Row& Row::operator=(const Row& copy) {
-        if (&copy == this) {
-            return *this;
-        }
+    void Matrix::allocate(size_t rows, size_t cols, size_t reserved_rows) {
+        size_t stride = paddedStride(cols);
+        size_t header = checkedAdd(checkedMultiply(std::max(rows, reserved_rows), sizeof(Row)), kAlignment - 1) /
+                        kAlignment * kAlignment;
+        size_t bytes = checkedAdd(header, checkedMultiply(checkedMultiply(rows, stride), sizeof(double)));
 
-        delete[] this->data;
-        this->data = new double[copy.size()];
-        this->size_ = copy.size();
+        char* storage = static_cast<char*>(this->memory->allocate(bytes, kAlignment));
 
-        for (size_t i = 0; i < size_; ++i) {
-            this->data[i] = copy.data[i];
-        }
+        this->capacity = bytes;
+        this->data = reinterpret_cast<Row*>(storage);
+        this->elements = reinterpret_cast<double*>(storage + header);
+        this->row_stride = stride;
+        this->dim_size = { rows, cols };
 
-        return *this;
+        layoutRows();
     }
 
-    Matrix::Matrix() {
-        this->data = new Row[1];
-        data[0] = Row();
-        data[0][0] = 1.0;
-        dim_size = { 1, 1 };
+    size_t Matrix::headerCapacity() const {
+        return (reinterpret_cast<const char*>(this->elements) - reinterpret_cast<const char*>(this->data)) / sizeof(Row);
     }
 
-    Matrix::Matrix(size_t rows, size_t cols) {
-        this->data = new Row[rows];
-        this->dim_size = { rows, cols };
+    void Matrix::layoutRows() {
+        for (size_t i = 0; i < this->dim_size.first; ++i) {
+            new (this->data + i) Row(this->elements + i * this->row_stride, this->dim_size.second);
+        }
+    }
 
-        for (size_t i = 0; i < rows; ++i) {
-            this->data[i] = Row(cols);
+    void Matrix::release() {
+        if (this->data != nullptr) {
+            this->memory->deallocate(this->data, this->capacity, kAlignment);
         }
+        this->data = nullptr;
+        this->elements = nullptr;
+    }
+
+    Matrix::BasicMatrix() : BasicMatrix(1, 1) {}
+
+    Matrix::BasicMatrix(size_t rows, size_t cols) : BasicMatrix(rows, cols, matrixResource()) {}
+
+    Matrix::BasicMatrix(size_t rows, size_t cols, std::pmr::memory_resource* resource)
+        : BasicMatrix(rows, cols, Uninitialized(), 0, resource) {
+        std::fill_n(this->elements, rows * this->row_stride, 0.0);
 
         for (size_t i = 0; i < std::min(cols, rows); ++i) {
             this->data[i][i] = 1.0;
         }
     }
 
-    Matrix operator*(const double &a, const Matrix &b) {
-        Matrix result(b);
-        result *= a;
-        return result;
+    Matrix::BasicMatrix(size_t rows, size_t cols, Uninitialized, size_t reserved_rows,
+                        std::pmr::memory_resource* resource) : memory(resource) {
+        allocate(rows, cols, reserved_rows);
     }
 
-    Matrix::Matrix(const Matrix& copy) {
-        this->data = new Row[copy.size().first];
-        this->dim_size = copy.size();
+    Matrix::BasicMatrix(const Matrix& copy) : BasicMatrix(copy, matrixResource()) {}
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            this->data[i] = Row(copy[i]);
-        }
+    Matrix::BasicMatrix(const Matrix& copy, std::pmr::memory_resource* resource)
+        : BasicMatrix(copy.dim_size.first, copy.dim_size.second, Uninitialized(), 0, resource) {
+        std::copy_n(copy.elements, this->dim_size.first * this->row_stride, this->elements);
     }
 
+    Matrix::BasicMatrix(Matrix&& other) noexcept
+        : data(nullptr), elements(nullptr), row_stride(0), dim_size(0, 0), capacity(0), memory(other.memory) {
+        swap(other);
+    }
+
+    // Keeps the resource of the target, as std::pmr containers do.
     Matrix& Matrix::operator=(const Matrix& a) {
         if (&a == this) {
             return *this;
         }
 
-        delete[] this->data;
+        if (this->dim_size != a.dim_size) {
+            Matrix copy(a, this->memory);
+            swap(copy);
+        } else {
+            std::copy_n(a.elements, this->dim_size.first * this->row_stride, this->elements);
+        }
 
-        this->data = new Row[a.size().first];
-        this->dim_size = a.size();
+        return *this;
+    }
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            this->data[i] = Row(a[i]);
+    Matrix& Matrix::operator=(Matrix&& a) noexcept {
+        if (&a != this) {
+            Matrix expiring(std::move(a));
+            swap(expiring);
         }
 
         return *this;
     }
 
-    Matrix::~Matrix() {
-        delete[] this->data;
+    void Matrix::swap(Matrix& other) noexcept {
+        std::swap(this->data, other.data);
+        std::swap(this->elements, other.elements);
+        std::swap(this->row_stride, other.row_stride);
+        std::swap(this->dim_size, other.dim_size);
+        std::swap(this->capacity, other.capacity);
+        std::swap(this->memory, other.memory);
+    }
+
+    Matrix::~BasicMatrix() {
+        release();
     }
 
     double& Matrix::get(size_t row, size_t col) {
@@ -140,26 +199,21 @@ namespace task {
     }
 
     void Matrix::resize(size_t new_rows, size_t new_cols) {
-        Row* new_data = new Row[new_rows];
-
-        for (size_t i = 0; i < new_rows; ++i) {
-            new_data[i] = Row(new_cols);
+        if (this->dim_size == std::make_pair(new_rows, new_cols)) {
+            return;
         }
 
+        Matrix resized(new_rows, new_cols, Uninitialized(), 0, this->memory);
+        std::fill_n(resized.elements, new_rows * resized.row_stride, 0.0);
+
         size_t row_size = std::min(this->dim_size.first, new_rows);
         size_t col_size = std::min(this->dim_size.second, new_cols);
 
         for (size_t i = 0; i < row_size; ++i) {
-            for (size_t j = 0; j < col_size; ++j) {
-                new_data[i][j] = this->data[i][j];
-            }
+            std::copy_n(this->data[i].data, col_size, resized.data[i].data);
         }
 
-        delete[] this->data;
-        this->data = new_data;
-
-        this->dim_size.first = new_rows;
-        this->dim_size.second = new_cols;
+        swap(resized);
     }
 
     Row& Matrix::operator[](size_t row) {
@@ -183,11 +237,9 @@ namespace task {
             throw SizeMismatchException();
         }
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                this->data[i][j] += a[i][j];
-            }
-        }
+        forEachSpan([&](size_t offset, size_t length) {
+            simd::add(this->elements + offset, a.elements + offset, this->elements + offset, length);
+        });
 
         return *this;
     }
@@ -197,66 +249,71 @@ namespace task {
             throw SizeMismatchException();
         }
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                this->data[i][j] -= a[i][j];
-            }
-        }
+        forEachSpan([&](size_t offset, size_t length) {
+            simd::sub(this->elements + offset, a.elements + offset, this->elements + offset, length);
+        });
 
         return *this;
     }
 
     Matrix& Matrix::operator*=(const double& number) {
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                this->data[i][j] *= number;
-            }
-        }
+        forEachSpan([&](size_t offset, size_t length) {
+            simd::scale(this->elements + offset, number, this->elements + offset, length);
+        });
 
         return *this;
     }
 
-    Matrix Matrix::operator+(const Matrix& a) const {
-        if (this->size() != a.size()) {
+    Matrix Matrix::operator*(const Matrix& a) const {
+        return multiply(*this, a, defaultExecutionPolicy());
+    }
+
+    Matrix Matrix::multiply(const Matrix& a, const Matrix& b, ExecutionPolicy policy) {
+        if (a.size().second != b.size().first) {
             throw SizeMismatchException();
         }
 
-        Matrix result = *this;
-        result += a;
+        Matrix result(a.dim_size.first, b.dim_size.second, Uninitialized());
+
+        gemm::multiply(a.dim_size.first, b.dim_size.second, a.dim_size.second,
+                       a.elements, a.row_stride,
+                       b.elements, b.row_stride,
+                       result.elements, result.row_stride, policy);
 
         return result;
     }
 
-
-    Matrix Matrix::operator-(const Matrix& a) const {
-        if (this->size() != a.size()) {
+    std::vector<double> Matrix::operator*(const std::vector<double>& x) const {
+        if (x.size() != this->dim_size.second) {
             throw SizeMismatchException();
         }
 
-        Matrix result = *this;
-        result -= a;
+        std::vector<double> result(this->dim_size.first);
+        gemm::gemv(this->dim_size.first, this->dim_size.second, this->elements, this->row_stride,
+                   x.data(), result.data(), defaultExecutionPolicy());
 
         return result;
     }
 
-    Matrix Matrix::operator*(const Matrix& a) const {
-        if (this->size().second != a.size().first) {
+    std::vector<double> Matrix::multiplyTransposed(const std::vector<double>& x) const {
+        if (x.size() != this->dim_size.first) {
             throw SizeMismatchException();
         }
 
-        Matrix result(this->dim_size.first, a.dim_size.second);
+        std::vector<double> result(this->dim_size.second);
+        gemm::gemvTransposed(this->dim_size.first, this->dim_size.second, this->elements, this->row_stride,
+                             x.data(), result.data(), defaultExecutionPolicy());
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < a.dim_size.second; ++j) {
-                result[i][j] = 0.0;
+        return result;
+    }
 
-                for (size_t k = 0; k < this->dim_size.second; ++k) {
-                    result[i][j] += this->data[i][k] * a[k][j];
-                }
-            }
+    void Matrix::rankOneUpdate(double alpha, const std::vector<double>& x, const std::vector<double>& y) {
+        if (x.size() != this->dim_size.first || y.size() != this->dim_size.second) {
+            throw SizeMismatchException();
         }
 
-        return result;
+        gemm::rank1Update(this->dim_size.first, this->dim_size.second, alpha, x.data(), y.data(),
+                          this->elements, this->row_stride, defaultExecutionPolicy());
     }
 
     Matrix& Matrix::operator*=(const Matrix& a) {
@@ -265,99 +322,155 @@ namespace task {
         return *this;
     }
 
-    Matrix Matrix::operator*(const double& a) const {
-        Matrix result(this->dim_size.first, this->dim_size.second);
+    Matrix Matrix::operator+() const& {
+        return *this;
+    }
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                result[i][j] = this->data[i].data[j] * a;
-            }
+    Matrix Matrix::operator+() && {
+        return std::move(*this);
+    }
+
+    double Determinant::value() const {
+        if (this->exponent > std::numeric_limits<int>::max()) {
+            return this->mantissa * std::numeric_limits<double>::infinity();
+        }
+        if (this->exponent < std::numeric_limits<int>::min()) {
+            return this->mantissa * 0.0;
         }
 
-        return result;
+        return std::ldexp(this->mantissa, static_cast<int>(this->exponent));
     }
 
-    Matrix Matrix::operator-() const {
-        Matrix result(this->dim_size.first, this->dim_size.second);
-
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                result[i][j] = -this->data[i][j];
-            }
+    double Determinant::logAbs() const {
+        if (this->mantissa == 0.0) {
+            return -std::numeric_limits<double>::infinity();
         }
 
-        return result;
+        return std::log(std::fabs(this->mantissa)) + this->exponent * std::log(2.0);
     }
 
-    Matrix Matrix::operator+() const {
-        return *this;
+    int Determinant::sign() const {
+        return (this->mantissa > 0.0) - (this->mantissa < 0.0);
     }
 
     double Matrix::det() const {
-        if (dim_size.first == dim_size.second) {
-            Matrix copy(*this);
+        return LU(*this).det();
+    }
 
-            size_t size = dim_size.first;
+    Determinant Matrix::determinant() const {
+        return LU(*this).determinant();
+    }
 
-            double result = 1.0;
-            for (size_t i = 0; i < size; ++i) {
-                size_t k = i;
 
-                for (size_t j = i + 1; j < size; ++j) {
-                    if (fabs(copy[j][i]) > fabs(copy[k][i])) {
-                        k = j;
-                    }
-                }
+    Matrix Matrix::transposed() const {
+        Matrix transponsed_matrix(this->dim_size.second, this->dim_size.first, Uninitialized());
+        transposeInto(transponsed_matrix);
 
-                if (abs(copy[k][i]) < EPS) {
-                    result = 0;
-                    break;
-                }
+        return transponsed_matrix;
+    }
 
-                std::swap_ranges(copy[i].data, copy[i].data + size, copy[k].data);
+    // Copies tile by tile so that both the rows read and the rows written
+    // stay in cache.
+    void Matrix::transposeInto(Matrix& result) const {
+        size_t rows = this->dim_size.first;
+        size_t cols = this->dim_size.second;
+        const double* source = this->elements;
+        double* target = result.elements;
+        size_t source_stride = this->row_stride;
+        size_t target_stride = result.row_stride;
 
-                if (i != k) {
-                    result = -result;
-                }
+        size_t tile_rows = (rows + kTransposeTile - 1) / kTransposeTile;
+        size_t grain = kParallelGrain / (kTransposeTile * (cols + 1)) + 1;
 
-                result *= copy[i][i];
+        parallelFor(defaultExecutionPolicy(), 0, tile_rows, grain, [&](size_t begin, size_t end) {
+            for (size_t ib = begin * kTransposeTile; ib < std::min(rows, end * kTransposeTile); ib += kTransposeTile) {
+                size_t i_end = std::min(rows, ib + kTransposeTile);
 
-                for (size_t j = i + 1; j < size; ++j) {
-                    copy[i][j] /= copy[i][i];
-                }
+                for (size_t jb = 0; jb < cols; jb += kTransposeTile) {
+                    size_t j_end = std::min(cols, jb + kTransposeTile);
 
-                for (size_t j = 0; j < size; ++j) {
-                    if (j != i && abs(copy[j][i]) > EPS) {
-                        for (size_t p = i + 1; p < size; ++p) {
-                            copy[j][p] -= copy[i][p] * copy[j][i];
+                    for (size_t i = ib; i < i_end; ++i) {
+                        for (size_t j = jb; j < j_end; ++j) {
+                            target[j * target_stride + i] = source[i * source_stride + j];
                         }
                     }
                 }
             }
+        });
+    }
 
-            return result;
-        } else {
-            throw SizeMismatchException();
-        }
+    // Swaps each tile above the diagonal with its mirror below it.
+    void Matrix::transposeSquare() {
+        size_t n = this->dim_size.first;
+        size_t stride = this->row_stride;
+        double* a = this->elements;
+
+        size_t tiles = (n + kTransposeTile - 1) / kTransposeTile;
+        size_t grain = kParallelGrain / (kTransposeTile * (n + 1)) + 1;
+
+        parallelFor(defaultExecutionPolicy(), 0, tiles, grain, [&](size_t begin, size_t end) {
+            for (size_t ib = begin * kTransposeTile; ib < std::min(n, end * kTransposeTile); ib += kTransposeTile) {
+                size_t i_end = std::min(n, ib + kTransposeTile);
+
+                for (size_t jb = ib; jb < n; jb += kTransposeTile) {
+                    size_t j_end = std::min(n, jb + kTransposeTile);
+
+                    for (size_t i = ib; i < i_end; ++i) {
+                        for (size_t j = std::max(jb, i + 1); j < j_end; ++j) {
+                            std::swap(a[i * stride + j], a[j * stride + i]);
+                        }
+                    }
+                }
+            }
+        });
     }
 
+    // Follows the permutation cycles of k -> k * rows mod (rows * cols - 1)
+    // over the unpadded buffer, with one bit per element to mark visited ones.
+    void Matrix::transposeCycles() {
+        size_t rows = this->dim_size.first;
+        size_t cols = this->dim_size.second;
+        size_t count = rows * cols;
+        double* a = this->elements;
 
-    Matrix Matrix::transposed() const {
-        Matrix transponsed_matrix(this->dim_size.second, this->dim_size.first);
+        if (count > 2) {
+            std::vector<bool> visited(count);
 
-        for (size_t i = 0; i < this->dim_size.first; ++i) {
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                transponsed_matrix[j][i] = this->data[i][j];
+            for (size_t start = 1; start + 1 < count; ++start) {
+                if (visited[start]) {
+                    continue;
+                }
+
+                double value = a[start];
+                size_t position = start;
+
+                do {
+                    position = position * rows % (count - 1);
+                    std::swap(value, a[position]);
+                    visited[position] = true;
+                } while (position != start);
             }
         }
 
-        return transponsed_matrix;
+        this->dim_size = { cols, rows };
+        this->row_stride = rows;
+        layoutRows();
     }
 
     void Matrix::transpose() {
-        Matrix copy = *this;
+        size_t rows = this->dim_size.first;
+        size_t cols = this->dim_size.second;
 
-        *this = copy.transposed();
+        if (rows == cols) {
+            transposeSquare();
+        } else if (this->row_stride == cols && paddedStride(rows) == rows && cols <= headerCapacity()) {
+            transposeCycles();
+        } else {
+            // Reserve headers for both shapes so that transposing back is in place.
+            Matrix result(cols, rows, Uninitialized(), std::max(rows, cols), this->memory);
+            transposeInto(result);
+            swap(result);
+        }
     }
 
     double Matrix::trace() const {
@@ -375,47 +488,57 @@ namespace task {
     }
 
     std::vector<double> Matrix::getRow(size_t row) {
-        if (row < this->dim_size.first) {
+        return this->row(row).toVector();
+    }
 
-            std::vector<double> result;
-            result.reserve(this->dim_size.second);
+    std::vector<double> Matrix::getColumn(size_t column) {
+        return this->column(column).toVector();
+    }
 
-            for (size_t j = 0; j < this->dim_size.second; ++j) {
-                result.push_back(this->data[row][j]);
-            }
+    RowView Matrix::row(size_t row) {
+        return view().row(row);
+    }
 
-            return result;
-        } else {
-            throw OutOfBoundsException();
-        }
+    ConstRowView Matrix::row(size_t row) const {
+        return view().row(row);
     }
 
-    std::vector<double> Matrix::getColumn(size_t column) {
-        if (column < this->dim_size.second) {
-            std::vector<double> result;
-            result.reserve(this->dim_size.first);
+    ColumnView Matrix::column(size_t column) {
+        return view().column(column);
+    }
 
-            for (size_t i = 0; i < this->dim_size.first; ++i) {
-                result.push_back(this->data[i][column]);
-            }
+    ConstColumnView Matrix::column(size_t column) const {
+        return view().column(column);
+    }
 
-            return result;
-        } else {
-            throw OutOfBoundsException();
-        }
+    SubMatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols) {
+        return view().block(row, col, rows, cols);
+    }
+
+    ConstSubMatrixView Matrix::block(size_t row, size_t col, size_t rows, size_t cols) const {
+        return view().block(row, col, rows, cols);
+    }
+
+    SubMatrixView Matrix::view() {
+        return SubMatrixView(this->elements, this->dim_size.first, this->dim_size.second, this->row_stride);
+    }
+
+    ConstSubMatrixView Matrix::view() const {
+        return ConstSubMatrixView(this->elements, this->dim_size.first, this->dim_size.second, this->row_stride);
     }
 
     bool Matrix::operator==(const Matrix& a) const {
         if (this->size() == a.size()) {
-            for (size_t i = 0; i < this->dim_size.first; ++i) {
-                for (size_t j = 0; j < this->dim_size.second; ++j) {
-                    if (fabs(this->data[i][j] - a[i][j]) >= EPS) {
-                        return false;
-                    }
+            std::atomic<bool> equal(true);
+
+            forEachSpan([&](size_t offset, size_t length) {
+                if (equal.load(std::memory_order_relaxed) &&
+                    !simd::equal(this->elements + offset, a.elements + offset, length, EPS)) {
+                    equal.store(false, std::memory_order_relaxed);
                 }
-            }
+            });
 
-            return true;
+            return equal.load();
         } else {
             throw SizeMismatchException();
         }
@@ -429,30 +552,62 @@ namespace task {
         return this->dim_size;
     }
 
-    std::ostream &operator<<(std::ostream &output, const Matrix &matrix) {
-        auto[rows, cols] = matrix.size();
+    size_t Matrix::stride() const {
+        return this->row_stride;
+    }
 
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                output << matrix[i][j] << " ";
-            }
-            output << "\n";
+    double* Matrix::rawData() {
+        return this->elements;
+    }
+
+    const double* Matrix::rawData() const {
+        return this->elements;
+    }
+
+    std::pmr::memory_resource* Matrix::memoryResource() const {
+        return this->memory;
+    }
+
+    size_t Matrix::spanCount() const {
+        if (this->row_stride == this->dim_size.second) {
+            return this->dim_size.first == 0 ? 0 : 1;
         }
 
-        return output;
+        return this->dim_size.first;
     }
 
-    std::istream &operator>>(std::istream &input, Matrix &matrix) {
-        size_t rows, cols;
-        input >> rows >> cols;
+    size_t Matrix::spanLength() const {
+        if (this->row_stride == this->dim_size.second) {
+            return this->dim_size.first * this->dim_size.second;
+        }
 
-        matrix = Matrix(rows, cols);
-        for (size_t i = 0; i < rows; ++i) {
-            for (size_t j = 0; j < cols; ++j) {
-                input >> matrix[i][j];
-            }
+        return this->dim_size.second;
+    }
+
+    template <class Kernel>
+    void Matrix::forEachSpan(Kernel kernel) const {
+        size_t count = spanCount();
+        size_t length = spanLength();
+
+        if (count == 1) {
+            parallelFor(defaultExecutionPolicy(), 0, length, kParallelGrain, [&](size_t begin, size_t end) {
+                kernel(begin, end - begin);
+            });
+        } else {
+            parallelFor(defaultExecutionPolicy(), 0, count, kParallelGrain / (length + 1) + 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    kernel(i * this->row_stride, length);
+                }
+            });
         }
+    }
 
-        return input;
+    std::ostream &operator<<(std::ostream &output, const Matrix &matrix) {
+        writeText(output, matrix);
+        return output;
+    }
+
+    std::istream &operator>>(std::istream &input, Matrix &matrix) {
+        return readText(input, matrix);
     }
 }
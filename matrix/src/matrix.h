@@ -4,18 +4,52 @@
 #include <iostream>
 #include <cmath>
 #include <algorithm>
+#include <new>
+#include <type_traits>
+
+#include "resource.h"
+#include "thread_pool.h"
 
 
 namespace task {
 
-const double EPS = 1e-6;
+constexpr double EPS = 1e-6;
 
 
 class OutOfBoundsException : public std::exception {};
 class SizeMismatchException : public std::exception {};
+class SingularMatrixException : public std::exception {};
+
+// Determinant in floating-point form, mantissa * 2^exponent, which neither
+// overflows nor underflows for any matrix that fits in memory. The mantissa
+// carries the sign and is 0 for singular matrices, otherwise
+// 0.5 <= |mantissa| < 1.
+struct Determinant {
+    double mantissa;
+    long exponent;
+
+    // mantissa * 2^exponent, infinite or zero if out of range of double.
+    double value() const;
+
+    // log|det|, -infinity for singular matrices; sign() is -1, 0 or 1.
+    double logAbs() const;
+    int sign() const;
+};
+
+// Dense matrix of T, see basic_matrix.h. Matrix, the double specialization
+// below, has its own implementation with SIMD kernels, blocked GEMM,
+// expression templates and views.
+template <class T>
+class BasicMatrix;
+
+using Matrix = BasicMatrix<double>;
 
+// One matrix row. The rows returned by operator[] live inside the storage
+// buffer of their Matrix, so references to them are valid only as long as
+// the matrix is not resized. A copy of a Row owns a copy of its elements, as
+// it always has; row() gives a view that aliases the matrix instead.
 class Row {
-    friend class Matrix;
+    friend class BasicMatrix<double>;
 
 public:
     double& operator[](size_t col);
@@ -24,26 +58,68 @@ public:
     size_t size() const;
 
     Row(const Row& copy);
-
     ~Row();
 
 private:
-    Row();
-    explicit Row(size_t size);
-    Row& operator=(const Row& copy);
+    Row(double* data, size_t size);
+    Row& operator=(const Row& copy) = delete;
 
     size_t size_;
     double* data;
+    // Set for copies only; rows inside a matrix are never destroyed.
+    bool owner;
 };
 
-class Matrix {
+namespace expr {
+
+// Base of the lazy nodes built by the element-wise operators, see expression.h.
+struct Node {};
+
+template <class T>
+using EnableIfNode = std::enable_if_t<std::is_base_of<Node, std::decay_t<T>>::value>;
+
+}  // namespace expr
+
+// Non-owning row, column and sub-matrix views, see view.h.
+template <class T> class BasicMatrixView;
+template <class T> class BasicRowView;
+template <class T> class BasicColumnView;
+
+using SubMatrixView = BasicMatrixView<double>;
+using ConstSubMatrixView = BasicMatrixView<const double>;
+using RowView = BasicRowView<double>;
+using ConstRowView = BasicRowView<const double>;
+using ColumnView = BasicColumnView<double>;
+using ConstColumnView = BasicColumnView<const double>;
+
+template <>
+class BasicMatrix<double> {
 
 public:
+    // Every buffer and every padded row starts on a cache line boundary.
+    static const size_t kAlignment = 64;
+
+    using value_type = double;
+
+    BasicMatrix();
+    BasicMatrix(size_t rows, size_t cols);
+    BasicMatrix(const Matrix& copy);
+
+    // Storage from `resource` instead of matrixResource(), see resource.h.
+    BasicMatrix(size_t rows, size_t cols, std::pmr::memory_resource* resource);
+    BasicMatrix(const Matrix& copy, std::pmr::memory_resource* resource);
 
-    Matrix();
-    Matrix(size_t rows, size_t cols);
-    Matrix(const Matrix& copy);
+    BasicMatrix(Matrix&& other) noexcept;
     Matrix& operator=(const Matrix& a);
+    Matrix& operator=(Matrix&& a) noexcept;
+
+    // Evaluate an element-wise expression in a single pass over memory.
+    template <class E, class = expr::EnableIfNode<E>>
+    BasicMatrix(const E& expression);
+    template <class E, class = expr::EnableIfNode<E>>
+    Matrix& operator=(const E& expression);
+
+    ~BasicMatrix();
 
     double& get(size_t row, size_t col);
     const double& get(size_t row, size_t col) const;
@@ -57,38 +133,112 @@ public:
     Matrix& operator-=(const Matrix& a);
     Matrix& operator*=(const Matrix& a);
     Matrix& operator*=(const double& number);
+    template <class E, class = expr::EnableIfNode<E>>
+    Matrix& operator+=(const E& expression);
+    template <class E, class = expr::EnableIfNode<E>>
+    Matrix& operator-=(const E& expression);
 
-    Matrix operator+(const Matrix& a) const;
-    Matrix operator-(const Matrix& a) const;
+    // Binary +, -, scalar * and unary - are lazy, see expression.h.
     Matrix operator*(const Matrix& a) const;
-    Matrix operator*(const double& a) const;
+    static Matrix multiply(const Matrix& a, const Matrix& b, ExecutionPolicy policy);
 
-    Matrix operator-() const;
-    Matrix operator+() const;
+    // A * x, A^T * x and A += alpha * x * y^T straight from the storage,
+    // see gemm.h. Throw SizeMismatchException if a length does not match.
+    std::vector<double> operator*(const std::vector<double>& x) const;
+    std::vector<double> multiplyTransposed(const std::vector<double>& x) const;
+    void rankOneUpdate(double alpha, const std::vector<double>& x, const std::vector<double>& y);
 
+    Matrix operator+() const&;
+    Matrix operator+() &&;
+
+    // LU factorization with partial pivoting, see lu.h. A pivot below EPS in
+    // magnitude makes det() exactly zero; determinant() is zero only for an
+    // exactly zero pivot, so it stays meaningful for tiny well-scaled matrices.
     double det() const;
+    Determinant determinant() const;
+
     void transpose();
     Matrix transposed() const;
     double trace() const;
 
+    // Copies of a row or column; row() and column() view them in place.
     std::vector<double> getRow(size_t row);
     std::vector<double> getColumn(size_t column);
 
+    RowView row(size_t row);
+    ConstRowView row(size_t row) const;
+    ColumnView column(size_t column);
+    ConstColumnView column(size_t column) const;
+    SubMatrixView block(size_t row, size_t col, size_t rows, size_t cols);
+    ConstSubMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const;
+    SubMatrixView view();
+    ConstSubMatrixView view() const;
+
     bool operator==(const Matrix& a) const;
     bool operator!=(const Matrix& a) const;
 
+    std::pair<size_t, size_t> size() const;
+
+    // Distance in elements between the starts of two consecutive rows.
+    size_t stride() const;
+
+    // Row-major elements; row i starts at rawData() + i * stride().
+    double* rawData();
+    const double* rawData() const;
+
+    // Where the storage came from and goes back to.
+    std::pmr::memory_resource* memoryResource() const;
+
 private:
+    friend Matrix readBinary(std::istream& input);
+
+    // Builds an uninitialized matrix; the caller fills every element.
+    // `reserved_rows` sizes the Row header area for in-place transposition.
+    struct Uninitialized {};
+    BasicMatrix(size_t rows, size_t cols, Uninitialized, size_t reserved_rows = 0,
+                std::pmr::memory_resource* resource = matrixResource());
+
+    // A matrix is a single allocation: the Row views come first, followed by
+    // the row-major elements, each row padded to `row_stride` elements.
+    static size_t paddedStride(size_t cols);
+    void allocate(size_t rows, size_t cols, size_t reserved_rows = 0);
+    size_t headerCapacity() const;
+    void layoutRows();
+    void release();
+    void swap(Matrix& other) noexcept;
+
+    // Element-wise kernels walk the buffer as spanCount() runs of
+    // spanLength() elements: a single run when rows are not padded, one run
+    // per row otherwise. Matrices of the same size share the same layout.
+    size_t spanCount() const;
+    size_t spanLength() const;
+
+    // Calls kernel(offset, length) for pieces of the spans, on the thread
+    // pool under the default execution policy.
+    template <class Kernel>
+    void forEachSpan(Kernel kernel) const;
+
+    void transposeInto(Matrix& result) const;
+    void transposeSquare();
+    void transposeCycles();
+
     Row* data;
+    double* elements;
+    size_t row_stride;
     std::pair<size_t, size_t> dim_size;
+    size_t capacity;
+    std::pmr::memory_resource* memory;
 
 };
 
 
-Matrix operator*(const double& a, const Matrix& b);
-
 std::ostream& operator<<(std::ostream& output, const Matrix& matrix);
 std::istream& operator>>(std::istream& input, Matrix& matrix);
 
 
 
 }  // namespace task
+
+
+#include "expression.h"
+#include "view.h"
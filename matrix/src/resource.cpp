@@ -0,0 +1,27 @@
+#include "resource.h"
+
+namespace task {
+
+    namespace {
+
+        thread_local std::pmr::memory_resource* current_resource = nullptr;
+
+    }  // namespace
+
+    std::pmr::memory_resource* matrixResource() {
+        return current_resource != nullptr ? current_resource : std::pmr::new_delete_resource();
+    }
+
+    void setMatrixResource(std::pmr::memory_resource* resource) {
+        current_resource = resource;
+    }
+
+    MatrixResourceScope::MatrixResourceScope(std::pmr::memory_resource* resource) : previous(current_resource) {
+        current_resource = resource;
+    }
+
+    MatrixResourceScope::~MatrixResourceScope() {
+        current_resource = this->previous;
+    }
+
+}  // namespace task
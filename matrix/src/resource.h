@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+
+
+namespace task {
+
+// Memory resource that new Matrix storage on the calling thread comes from,
+// std::pmr::new_delete_resource() unless changed. Every request asks for
+// Matrix::kAlignment, which all standard resources honour.
+//
+// A matrix keeps the resource it was created with and returns its storage
+// there, so the resource must outlive it. As with std::pmr containers,
+// copies allocate from the current resource and copy assignment reuses the
+// resource of the target; moves take the storage along with its resource.
+std::pmr::memory_resource* matrixResource();
+
+// nullptr restores the default.
+void setMatrixResource(std::pmr::memory_resource* resource);
+
+// Makes `resource` the matrix resource of the calling thread until the end
+// of the scope, so that every temporary of a computation comes from it:
+//
+//     std::pmr::monotonic_buffer_resource arena;
+//     {
+//         task::MatrixResourceScope scope(&arena);
+//         ...
+//     }
+//
+// releases all of them at once when the arena is destroyed.
+class MatrixResourceScope {
+public:
+    explicit MatrixResourceScope(std::pmr::memory_resource* resource);
+    MatrixResourceScope(const MatrixResourceScope&) = delete;
+    MatrixResourceScope& operator=(const MatrixResourceScope&) = delete;
+    ~MatrixResourceScope();
+
+private:
+    std::pmr::memory_resource* previous;
+};
+
+// Memory resource over an STL-style allocator, such as ChunkAllocator from
+// chuck_allocator/, that only aligns to alignof(value_type). Blocks are
+// over-allocated and aligned by hand, with the start of the underlying
+// allocation stored just before the aligned block.
+//
+// Whatever limits the allocator has apply to every matrix. ChunkAllocator in
+// particular throws std::bad_alloc for blocks larger than its chunk, which is
+// only 1024 elements by default, so pass one built with a chunk_size above
+// the largest matrix, plus its row headers and Matrix::kAlignment:
+//
+//     task::AllocatorResource<ChunkAllocator<char>> resource{
+//         ChunkAllocator<char>(ChunkOptions{ 64 << 20 })};
+template <class Allocator>
+class AllocatorResource : public std::pmr::memory_resource {
+public:
+    explicit AllocatorResource(const Allocator& allocator = Allocator());
+
+    Allocator allocator() const;
+
+private:
+    using ByteAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<char>;
+    using ByteTraits = std::allocator_traits<ByteAllocator>;
+
+    static size_t allocationSize(size_t bytes, size_t alignment);
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    ByteAllocator bytes_allocator;
+};
+
+}  // namespace task
+
+
+#include "resource.tpp"
@@ -0,0 +1,46 @@
+#include "resource.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace task {
+
+    template <class Allocator>
+    AllocatorResource<Allocator>::AllocatorResource(const Allocator& allocator) : bytes_allocator(allocator) {}
+
+    template <class Allocator>
+    Allocator AllocatorResource<Allocator>::allocator() const {
+        return Allocator(this->bytes_allocator);
+    }
+
+    template <class Allocator>
+    size_t AllocatorResource<Allocator>::allocationSize(size_t bytes, size_t alignment) {
+        return bytes + alignment - 1 + sizeof(char*);
+    }
+
+    template <class Allocator>
+    void* AllocatorResource<Allocator>::do_allocate(size_t bytes, size_t alignment) {
+        char* raw = ByteTraits::allocate(this->bytes_allocator, allocationSize(bytes, alignment));
+
+        uintptr_t start = reinterpret_cast<uintptr_t>(raw) + sizeof(char*);
+        char* aligned = raw + ((start + alignment - 1) / alignment * alignment - reinterpret_cast<uintptr_t>(raw));
+
+        std::memcpy(aligned - sizeof(char*), &raw, sizeof(char*));
+        return aligned;
+    }
+
+    template <class Allocator>
+    void AllocatorResource<Allocator>::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+        char* raw;
+        std::memcpy(&raw, static_cast<char*>(ptr) - sizeof(char*), sizeof(char*));
+
+        ByteTraits::deallocate(this->bytes_allocator, raw, allocationSize(bytes, alignment));
+    }
+
+    template <class Allocator>
+    bool AllocatorResource<Allocator>::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+        auto* resource = dynamic_cast<const AllocatorResource*>(&other);
+        return resource != nullptr && resource->bytes_allocator == this->bytes_allocator;
+    }
+
+}  // namespace task
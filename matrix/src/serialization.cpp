@@ -0,0 +1,601 @@
+#include "serialization.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace task {
+
+    namespace {
+
+        const char kMagic[8] = { 'T', 'M', 'A', 'T', 'R', 'I', 'X', '\0' };
+        const uint32_t kVersion = 1;
+
+        uint64_t rotateLeft(uint64_t value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        // Size of the data in bytes, or 0 if it does not fit in a size_t.
+        size_t dataBytes(uint64_t rows, uint64_t cols) {
+            const uint64_t limit = std::numeric_limits<size_t>::max() / sizeof(double);
+            if (cols != 0 && rows > limit / cols) {
+                return 0;
+            }
+            return static_cast<size_t>(rows * cols * sizeof(double));
+        }
+
+        // Validates everything but the checksum.
+        void checkHeader(const MatrixFileHeader& header) {
+            if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+                header.version != kVersion ||
+                header.dtype != MatrixDtype::kFloat64 ||
+                header.alignment < alignof(double) || (header.alignment & (header.alignment - 1)) != 0 ||
+                header.data_offset < sizeof(MatrixFileHeader) ||
+                header.data_offset % header.alignment != 0) {
+                throw MatrixFormatException();
+            }
+
+            if (header.rows != 0 && header.cols != 0 && dataBytes(header.rows, header.cols) == 0) {
+                throw MatrixFormatException();
+            }
+        }
+
+        // Bytes between the read position and the end of a seekable stream,
+        // or kUnknownSize if the stream cannot seek.
+        const size_t kUnknownSize = std::numeric_limits<size_t>::max();
+
+        size_t remainingBytes(std::istream& input) {
+            std::streampos position = input.tellg();
+            if (position == std::streampos(-1)) {
+                return kUnknownSize;
+            }
+
+            if (!input.seekg(0, std::ios::end)) {
+                input.clear(input.rdstate() & ~std::ios::failbit);
+                input.seekg(position);
+                return kUnknownSize;
+            }
+            std::streampos end = input.tellg();
+            input.seekg(position);
+
+            if (end == std::streampos(-1) || !input) {
+                input.clear(input.rdstate() & ~std::ios::failbit);
+                return kUnknownSize;
+            }
+            return end > position ? static_cast<size_t>(end - position) : 0;
+        }
+
+        // Streams that cannot tell their size are read in pieces of this
+        // many bytes before the matrix is allocated, so that a corrupted
+        // header runs out of input instead of memory.
+        const size_t kUnsizedPiece = 1 << 24;
+
+        void throwSystemError() {
+            throw std::system_error(errno, std::generic_category());
+        }
+
+        // Buffers of at least this many bytes are parsed in parallel.
+        const size_t kParallelTextBytes = 1 << 20;
+
+        // Output is formatted into a buffer of this size before each write.
+        const size_t kTextBuffer = 1 << 14;
+
+        bool isSpace(char c) {
+            return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+        }
+
+        const char* skipSpaces(const char* begin, const char* end) {
+            while (begin != end && isSpace(*begin)) {
+                ++begin;
+            }
+            return begin;
+        }
+
+        const char* tokenEnd(const char* begin, const char* end) {
+            while (begin != end && !isSpace(*begin)) {
+                ++begin;
+            }
+            return begin;
+        }
+
+        // Whole token as a number; iostreams also accept a leading '+'.
+        template <class T>
+        bool parseToken(const char* begin, const char* end, T& value) {
+            if (begin != end && *begin == '+') {
+                ++begin;
+            }
+
+            auto result = std::from_chars(begin, end, value);
+            return result.ec == std::errc() && result.ptr == end && begin != end;
+        }
+
+        template <class T>
+        const char* parseNumber(const char* begin, const char* end, T& value) {
+            begin = skipSpaces(begin, end);
+            const char* token_end = tokenEnd(begin, end);
+
+            if (!parseToken(begin, token_end, value)) {
+                throw MatrixFormatException();
+            }
+            return token_end;
+        }
+
+        size_t countTokens(const char* begin, const char* end) {
+            size_t count = 0;
+            while ((begin = skipSpaces(begin, end)) != end) {
+                begin = tokenEnd(begin, end);
+                ++count;
+            }
+            return count;
+        }
+
+        // Parses numbers from [begin, end) into consecutive elements starting
+        // at `index`, leaving it one past the last one written; false if a
+        // token is malformed or past the last element.
+        bool parseElements(const char* begin, const char* end, size_t& index, Matrix& result) {
+            auto[rows, cols] = result.size();
+            double* elements = result.rawData();
+
+            while ((begin = skipSpaces(begin, end)) != end) {
+                const char* token_end = tokenEnd(begin, end);
+                if (index == rows * cols ||
+                    !parseToken(begin, token_end, elements[index / cols * result.stride() + index % cols])) {
+                    return false;
+                }
+
+                begin = token_end;
+                ++index;
+            }
+
+            return true;
+        }
+
+        // Reads the next whitespace-separated token straight from the stream
+        // buffer, consuming nothing past it.
+        bool readToken(std::streambuf& buffer, std::string& token, std::ios::iostate& state) {
+            using Traits = std::char_traits<char>;
+            token.clear();
+
+            auto c = buffer.sgetc();
+            while (!Traits::eq_int_type(c, Traits::eof()) && isSpace(Traits::to_char_type(c))) {
+                c = buffer.snextc();
+            }
+            while (!Traits::eq_int_type(c, Traits::eof()) && !isSpace(Traits::to_char_type(c))) {
+                token.push_back(Traits::to_char_type(c));
+                c = buffer.snextc();
+            }
+
+            if (Traits::eq_int_type(c, Traits::eof())) {
+                state |= std::ios::eofbit;
+            }
+            return !token.empty();
+        }
+
+        template <class T>
+        bool readNumber(std::streambuf& buffer, std::string& token, std::ios::iostate& state, T& value) {
+            return readToken(buffer, token, state) && parseToken(token.data(), token.data() + token.size(), value);
+        }
+
+    }  // namespace
+
+    uint64_t matrixChecksum(const void* data, size_t bytes, uint64_t seed) {
+        const unsigned char* input = static_cast<const unsigned char*>(data);
+        uint64_t hash = seed;
+
+        for (size_t offset = 0; offset + sizeof(uint64_t) <= bytes; offset += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, input + offset, sizeof(word));
+            hash = (rotateLeft(hash, 5) ^ word ^ 0x9E3779B97F4A7C15ull) * 0xFF51AFD7ED558CCDull;
+        }
+
+        return hash;
+    }
+
+    void writeBinary(std::ostream& output, const Matrix& matrix) {
+        auto[rows, cols] = matrix.size();
+        size_t row_bytes = cols * sizeof(double);
+
+        MatrixFileHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.dtype = MatrixDtype::kFloat64;
+        header.rows = rows;
+        header.cols = cols;
+        header.data_offset = Matrix::kAlignment;
+        header.alignment = Matrix::kAlignment;
+
+        // Padding between rows is not written.
+        for (size_t i = 0; i < rows; ++i) {
+            header.checksum = matrixChecksum(matrix.rawData() + i * matrix.stride(), row_bytes, header.checksum);
+        }
+
+        static_assert(sizeof(MatrixFileHeader) <= Matrix::kAlignment, "header must fit before the data");
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        const char zeros[Matrix::kAlignment] = {};
+        output.write(zeros, Matrix::kAlignment - sizeof(header));
+
+        if (matrix.stride() == cols) {
+            output.write(reinterpret_cast<const char*>(matrix.rawData()), rows * row_bytes);
+        } else {
+            for (size_t i = 0; i < rows; ++i) {
+                output.write(reinterpret_cast<const char*>(matrix.rawData() + i * matrix.stride()), row_bytes);
+            }
+        }
+    }
+
+    Matrix readBinary(std::istream& input) {
+        MatrixFileHeader header;
+        if (!input.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            throw MatrixFormatException();
+        }
+        checkHeader(header);
+
+        if (!input.ignore(header.data_offset - sizeof(header))) {
+            throw MatrixFormatException();
+        }
+
+        size_t rows = header.rows;
+        size_t row_bytes = header.cols * sizeof(double);
+        size_t bytes = rows * row_bytes;
+
+        size_t remaining = remainingBytes(input);
+        if (remaining != kUnknownSize && bytes > remaining) {
+            throw MatrixFormatException();
+        }
+
+        std::string staged;
+        if (remaining == kUnknownSize && bytes > kUnsizedPiece) {
+            while (staged.size() < bytes) {
+                size_t offset = staged.size();
+                staged.resize(offset + std::min(kUnsizedPiece, bytes - offset));
+                if (!input.read(&staged[offset], staged.size() - offset)) {
+                    throw MatrixFormatException();
+                }
+            }
+        }
+
+        // Every element is read below, or the input is rejected.
+        Matrix result(rows, header.cols, Matrix::Uninitialized());
+        uint64_t checksum = 0;
+
+        if (!staged.empty()) {
+            for (size_t i = 0; i < rows; ++i) {
+                std::memcpy(result.rawData() + i * result.stride(), staged.data() + i * row_bytes, row_bytes);
+            }
+            checksum = matrixChecksum(staged.data(), bytes);
+        } else if (result.stride() == header.cols) {
+            if (!input.read(reinterpret_cast<char*>(result.rawData()), bytes)) {
+                throw MatrixFormatException();
+            }
+            checksum = matrixChecksum(result.rawData(), bytes);
+        } else {
+            for (size_t i = 0; i < rows; ++i) {
+                double* row = result.rawData() + i * result.stride();
+                if (!input.read(reinterpret_cast<char*>(row), row_bytes)) {
+                    throw MatrixFormatException();
+                }
+                checksum = matrixChecksum(row, row_bytes, checksum);
+            }
+        }
+
+        if (checksum != header.checksum) {
+            throw MatrixFormatException();
+        }
+
+        return result;
+    }
+
+    void saveBinary(const std::string& path, const Matrix& matrix) {
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output) {
+            throwSystemError();
+        }
+
+        writeBinary(output, matrix);
+        if (!output.flush()) {
+            throwSystemError();
+        }
+    }
+
+    Matrix loadBinary(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throwSystemError();
+        }
+
+        return readBinary(input);
+    }
+
+    void writeText(std::ostream& output, const Matrix& matrix) {
+        auto[rows, cols] = matrix.size();
+        char buffer[kTextBuffer];
+        char* position = buffer;
+
+        // The longest shortest form of a double is 24 characters.
+        const size_t kMaxNumber = 32;
+
+        for (size_t i = 0; i < rows; ++i) {
+            const double* row = matrix.rawData() + i * matrix.stride();
+
+            for (size_t j = 0; j < cols; ++j) {
+                if (buffer + kTextBuffer - position < static_cast<std::ptrdiff_t>(kMaxNumber)) {
+                    output.write(buffer, position - buffer);
+                    position = buffer;
+                }
+
+                position = std::to_chars(position, buffer + kTextBuffer, row[j]).ptr;
+                *position++ = ' ';
+            }
+
+            if (position == buffer + kTextBuffer) {
+                output.write(buffer, position - buffer);
+                position = buffer;
+            }
+            *position++ = '\n';
+        }
+
+        output.write(buffer, position - buffer);
+    }
+
+    std::istream& readText(std::istream& input, Matrix& matrix) {
+        std::istream::sentry sentry(input);
+        if (!sentry) {
+            return input;
+        }
+
+        std::streambuf& buffer = *input.rdbuf();
+        std::ios::iostate state = std::ios::goodbit;
+        std::string token;
+        size_t rows, cols;
+
+        if (!readNumber(buffer, token, state, rows) || !readNumber(buffer, token, state, cols)) {
+            input.setstate(state | std::ios::failbit);
+            return input;
+        }
+
+        // Every number takes a character and a separator but the last, as
+        // in parseText; the sizes are checked against the rest of the stream
+        // before anything is allocated.
+        size_t remaining = remainingBytes(input);
+        size_t total = rows * cols;
+        if (rows != 0 && cols != 0 &&
+            (dataBytes(rows, cols) == 0 || (remaining != kUnknownSize && total > (remaining + 1) / 2))) {
+            input.setstate(state | std::ios::failbit);
+            return input;
+        }
+
+        // Streams that cannot tell their size are read before allocating,
+        // so that a bogus header runs out of input instead of memory.
+        std::vector<double> values;
+        if (remaining == kUnknownSize && total * sizeof(double) > kUnsizedPiece) {
+            values.reserve(kUnsizedPiece / sizeof(double));
+            for (double value; values.size() < total; values.push_back(value)) {
+                if (!readNumber(buffer, token, state, value)) {
+                    input.setstate(state | std::ios::failbit);
+                    return input;
+                }
+            }
+        }
+
+        Matrix result(rows, cols);
+        for (size_t i = 0; i < rows; ++i) {
+            double* row = result.rawData() + i * result.stride();
+
+            if (!values.empty()) {
+                std::copy_n(values.data() + i * cols, cols, row);
+                continue;
+            }
+
+            for (size_t j = 0; j < cols; ++j) {
+                if (!readNumber(buffer, token, state, row[j])) {
+                    input.setstate(state | std::ios::failbit);
+                    return input;
+                }
+            }
+        }
+
+        matrix = std::move(result);
+        input.setstate(state);
+        return input;
+    }
+
+    Matrix parseText(const char* begin, const char* end, ExecutionPolicy policy) {
+        size_t rows, cols;
+        begin = parseNumber(begin, end, rows);
+        begin = parseNumber(begin, end, cols);
+
+        // Every number takes a character and a separator but the last.
+        size_t most = (static_cast<size_t>(end - begin) + 1) / 2;
+        if (rows != 0 && cols != 0 && (cols > most || rows > most / cols)) {
+            throw MatrixFormatException();
+        }
+
+        Matrix result(rows, cols);
+        size_t total = rows * cols;
+
+        size_t chunks = 1;
+        if (policy == ExecutionPolicy::kParallel && static_cast<size_t>(end - begin) >= kParallelTextBytes) {
+            chunks = ThreadPool::instance().threadCount() * 4;
+        }
+
+        // Chunk boundaries are moved forward to the next whitespace so that
+        // no number is split.
+        std::vector<const char*> bounds(chunks + 1, end);
+        bounds[0] = begin;
+        for (size_t c = 1; c < chunks; ++c) {
+            const char* bound = std::max(bounds[c - 1], begin + (end - begin) / chunks * c);
+            bounds[c] = tokenEnd(bound, end);
+        }
+
+        // Element index of the first number of every chunk.
+        std::vector<size_t> first(chunks + 1, 0);
+        if (chunks > 1) {
+            parallelFor(policy, 0, chunks, 1, [&](size_t from, size_t to) {
+                for (size_t c = from; c < to; ++c) {
+                    first[c + 1] = countTokens(bounds[c], bounds[c + 1]);
+                }
+            });
+            for (size_t c = 0; c < chunks; ++c) {
+                first[c + 1] += first[c];
+            }
+        }
+
+        std::atomic<bool> valid(chunks == 1 || first[chunks] == total);
+        parallelFor(policy, 0, chunks, 1, [&](size_t from, size_t to) {
+            for (size_t c = from; c < to && valid.load(std::memory_order_relaxed); ++c) {
+                if (!parseElements(bounds[c], bounds[c + 1], first[c], result)) {
+                    valid.store(false, std::memory_order_relaxed);
+                }
+            }
+        });
+
+        // A single chunk was not counted beforehand.
+        if (!valid.load() || (chunks == 1 && first[0] != total)) {
+            throw MatrixFormatException();
+        }
+
+        return result;
+    }
+
+    Matrix loadText(const std::string& path, ExecutionPolicy policy) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            throwSystemError();
+        }
+
+        std::string text((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        return parseText(text.data(), text.data() + text.size(), policy);
+    }
+
+    MappedMatrix::MappedMatrix(const std::string& path)
+        : mapping(nullptr), mapping_size(0), header(nullptr), elements(nullptr) {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            throwSystemError();
+        }
+
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category());
+        }
+
+        if (static_cast<uint64_t>(info.st_size) < sizeof(MatrixFileHeader)) {
+            ::close(fd);
+            throw MatrixFormatException();
+        }
+
+        this->mapping_size = static_cast<size_t>(info.st_size);
+        void* address = ::mmap(nullptr, this->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        int error = errno;
+        ::close(fd);
+
+        if (address == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category());
+        }
+        this->mapping = address;
+
+        // The mapping is page aligned, so the data is as aligned as the file says.
+        this->header = static_cast<const MatrixFileHeader*>(this->mapping);
+        try {
+            checkHeader(*this->header);
+            size_t bytes = dataBytes(this->header->rows, this->header->cols);
+            if (this->header->data_offset > this->mapping_size ||
+                bytes > this->mapping_size - this->header->data_offset) {
+                throw MatrixFormatException();
+            }
+        } catch (...) {
+            unmap();
+            throw;
+        }
+
+        this->elements = reinterpret_cast<const double*>(
+            static_cast<const char*>(this->mapping) + this->header->data_offset);
+    }
+
+    MappedMatrix::MappedMatrix(MappedMatrix&& other) noexcept
+        : mapping(other.mapping), mapping_size(other.mapping_size),
+          header(other.header), elements(other.elements) {
+        other.mapping = nullptr;
+        other.mapping_size = 0;
+        other.header = nullptr;
+        other.elements = nullptr;
+    }
+
+    MappedMatrix& MappedMatrix::operator=(MappedMatrix&& other) noexcept {
+        if (this != &other) {
+            unmap();
+            std::swap(this->mapping, other.mapping);
+            std::swap(this->mapping_size, other.mapping_size);
+            std::swap(this->header, other.header);
+            std::swap(this->elements, other.elements);
+        }
+
+        return *this;
+    }
+
+    MappedMatrix::~MappedMatrix() {
+        unmap();
+    }
+
+    void MappedMatrix::unmap() {
+        if (this->mapping != nullptr) {
+            ::munmap(this->mapping, this->mapping_size);
+        }
+
+        this->mapping = nullptr;
+        this->mapping_size = 0;
+        this->header = nullptr;
+        this->elements = nullptr;
+    }
+
+    std::pair<size_t, size_t> MappedMatrix::size() const {
+        if (this->header == nullptr) {
+            return { 0, 0 };
+        }
+        return { this->header->rows, this->header->cols };
+    }
+
+    ConstSubMatrixView MappedMatrix::view() const {
+        auto[rows, cols] = size();
+        return ConstSubMatrixView(this->elements, rows, cols, cols);
+    }
+
+    ConstRowView MappedMatrix::row(size_t row) const {
+        return view().row(row);
+    }
+
+    ConstColumnView MappedMatrix::column(size_t column) const {
+        return view().column(column);
+    }
+
+    const double& MappedMatrix::get(size_t row, size_t col) const {
+        return view().get(row, col);
+    }
+
+    const double* MappedMatrix::rawData() const {
+        return this->elements;
+    }
+
+    bool MappedMatrix::verify() const {
+        if (this->header == nullptr) {
+            return true;
+        }
+
+        auto[rows, cols] = size();
+        return matrixChecksum(this->elements, rows * cols * sizeof(double)) == this->header->checksum;
+    }
+
+}  // namespace task
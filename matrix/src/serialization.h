@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// Thrown when binary input is truncated, corrupted or in an unknown format.
+class MatrixFormatException : public std::exception {};
+
+// Binary matrix format, in native little-endian byte order:
+//
+//   offset  size  field
+//        0     8  magic "TMATRIX\0"
+//        8     4  format version (1)
+//       12     4  element type, a MatrixDtype
+//       16     8  rows
+//       24     8  cols
+//       32     8  data offset, a multiple of the data alignment
+//       40     8  data alignment (Matrix::kAlignment)
+//       48     8  checksum of the data bytes
+//       56     8  reserved, zero
+//
+// followed at the data offset by rows * cols row-major elements without
+// padding. Files are written and read with the stream functions below;
+// MappedMatrix opens them without reading the data at all.
+enum class MatrixDtype : uint32_t {
+    kFloat64 = 1,
+};
+
+struct MatrixFileHeader {
+    char magic[8];
+    uint32_t version;
+    MatrixDtype dtype;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t data_offset;
+    uint64_t alignment;
+    uint64_t checksum;
+    uint64_t reserved;
+};
+
+static_assert(sizeof(MatrixFileHeader) == 64, "MatrixFileHeader must stay 64 bytes");
+
+// Checksum over the data bytes, stored in the header. `bytes` is a multiple
+// of 8; pass the previous result as `seed` to continue over the next piece.
+uint64_t matrixChecksum(const void* data, size_t bytes, uint64_t seed = 0);
+
+// Write and read the binary format. Reading goes straight into the buffer of
+// the result, one bulk read per row at most, and verifies the checksum. The
+// header is checked against the bytes left in the stream before anything is
+// allocated; streams that cannot seek are read in pieces first instead.
+// Throw MatrixFormatException on malformed input.
+void writeBinary(std::ostream& output, const Matrix& matrix);
+Matrix readBinary(std::istream& input);
+
+void saveBinary(const std::string& path, const Matrix& matrix);
+Matrix loadBinary(const std::string& path);
+
+// Text format: "rows cols" followed by rows * cols numbers separated by
+// whitespace, one matrix row per line. Numbers are converted with
+// std::from_chars and std::to_chars instead of locale-aware iostreams.
+//
+// writeText writes the elements only, as operator<< always has, each in the
+// shortest form that reads back to the same double. readText consumes
+// exactly one matrix from the stream; on malformed input, including sizes
+// the rest of the stream cannot hold, it sets failbit and leaves `matrix`
+// unchanged.
+void writeText(std::ostream& output, const Matrix& matrix);
+std::istream& readText(std::istream& input, Matrix& matrix);
+
+// Parses a whole buffer holding one matrix. Under kParallel large buffers
+// are split on whitespace and converted on the thread pool. Throw
+// MatrixFormatException on malformed input.
+Matrix parseText(const char* begin, const char* end, ExecutionPolicy policy = defaultExecutionPolicy());
+Matrix loadText(const std::string& path, ExecutionPolicy policy = defaultExecutionPolicy());
+
+// Read-only matrix backed by a private memory mapping of a binary file.
+// Opening validates the header only, so it takes constant time; pages are
+// read by the kernel on first access and shared with the page cache.
+// Throws std::system_error if the file cannot be opened or mapped.
+class MappedMatrix {
+public:
+    explicit MappedMatrix(const std::string& path);
+    MappedMatrix(MappedMatrix&& other) noexcept;
+    MappedMatrix& operator=(MappedMatrix&& other) noexcept;
+    MappedMatrix(const MappedMatrix&) = delete;
+    MappedMatrix& operator=(const MappedMatrix&) = delete;
+    ~MappedMatrix();
+
+    std::pair<size_t, size_t> size() const;
+
+    // The elements as a view, usable wherever a ConstSubMatrixView is;
+    // `Matrix copy = mapped.view()` loads them into memory.
+    ConstSubMatrixView view() const;
+    ConstRowView row(size_t row) const;
+    ConstColumnView column(size_t column) const;
+    const double& get(size_t row, size_t col) const;
+
+    const double* rawData() const;
+
+    // Recomputes the checksum over the whole mapping.
+    bool verify() const;
+
+private:
+    void unmap();
+
+    void* mapping;
+    size_t mapping_size;
+    const MatrixFileHeader* header;
+    const double* elements;
+};
+
+}  // namespace task
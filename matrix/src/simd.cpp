@@ -0,0 +1,874 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TASK_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace task {
+
+    namespace {
+
+        struct Kernels {
+            void (*add)(const double*, const double*, double*, size_t);
+            void (*sub)(const double*, const double*, double*, size_t);
+            void (*scale)(const double*, double, double*, size_t);
+            void (*negate)(const double*, double*, size_t);
+            bool (*equal)(const double*, const double*, size_t, double);
+            void (*axpy)(double, const double*, double*, size_t);
+            void (*multiply)(const double*, const double*, double*, size_t);
+            void (*multiplyAdd)(const double*, const double*, double*, size_t);
+            double (*dot)(const double*, const double*, size_t);
+        };
+
+        struct FloatKernels {
+            void (*add)(const float*, const float*, float*, size_t);
+            void (*sub)(const float*, const float*, float*, size_t);
+            void (*scale)(const float*, float, float*, size_t);
+            void (*negate)(const float*, float*, size_t);
+            bool (*equal)(const float*, const float*, size_t, float);
+            void (*axpy)(float, const float*, float*, size_t);
+        };
+
+        // The scalar level, and the tails of the vector kernels.
+        template <class T>
+        void addScalar(const T* a, const T* b, T* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = a[i] + b[i];
+            }
+        }
+
+        template <class T>
+        void subScalar(const T* a, const T* b, T* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = a[i] - b[i];
+            }
+        }
+
+        template <class T>
+        void scaleScalar(const T* a, T factor, T* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = a[i] * factor;
+            }
+        }
+
+        template <class T>
+        void negateScalar(const T* a, T* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = -a[i];
+            }
+        }
+
+        // Written as `>=` so that NaNs compare equal, as in Matrix::operator==.
+        template <class T>
+        bool equalScalar(const T* a, const T* b, size_t n, T eps) {
+            for (size_t i = 0; i < n; ++i) {
+                if (std::fabs(a[i] - b[i]) >= eps) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        template <class T>
+        void axpyScalar(T factor, const T* x, T* y, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                y[i] += factor * x[i];
+            }
+        }
+
+        void multiplyScalar(const double* a, const double* b, double* out, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                out[i] = a[i] * b[i];
+            }
+        }
+
+        void multiplyAddScalar(const double* a, const double* b, double* c, size_t n) {
+            for (size_t i = 0; i < n; ++i) {
+                c[i] += a[i] * b[i];
+            }
+        }
+
+        double dotScalar(const double* a, const double* b, size_t n) {
+            double result = 0.0;
+            for (size_t i = 0; i < n; ++i) {
+                result += a[i] * b[i];
+            }
+
+            return result;
+        }
+
+        const Kernels kScalarKernels = {
+            addScalar, subScalar, scaleScalar, negateScalar, equalScalar, axpyScalar, multiplyScalar, multiplyAddScalar,
+            dotScalar
+        };
+
+        const FloatKernels kFloatScalarKernels = {
+            addScalar, subScalar, scaleScalar, negateScalar, equalScalar, axpyScalar
+        };
+
+#ifdef TASK_SIMD_X86
+
+        void addSse2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(out + i, _mm_add_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            }
+            addScalar(a + i, b + i, out + i, n - i);
+        }
+
+        void subSse2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(out + i, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            }
+            subScalar(a + i, b + i, out + i, n - i);
+        }
+
+        void scaleSse2(const double* a, double factor, double* out, size_t n) {
+            __m128d f = _mm_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), f));
+            }
+            scaleScalar(a + i, factor, out + i, n - i);
+        }
+
+        void negateSse2(const double* a, double* out, size_t n) {
+            __m128d sign = _mm_set1_pd(-0.0);
+
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(out + i, _mm_xor_pd(_mm_loadu_pd(a + i), sign));
+            }
+            negateScalar(a + i, out + i, n - i);
+        }
+
+        bool equalSse2(const double* a, const double* b, size_t n, double eps) {
+            __m128d sign = _mm_set1_pd(-0.0);
+            __m128d e = _mm_set1_pd(eps);
+
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                __m128d diff = _mm_andnot_pd(sign, _mm_sub_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+                if (_mm_movemask_pd(_mm_cmpge_pd(diff, e))) {
+                    return false;
+                }
+            }
+            return equalScalar(a + i, b + i, n - i, eps);
+        }
+
+        void axpySse2(double factor, const double* x, double* y, size_t n) {
+            __m128d f = _mm_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(_mm_loadu_pd(x + i), f)));
+            }
+            axpyScalar(factor, x + i, y + i, n - i);
+        }
+
+        void multiplySse2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                _mm_storeu_pd(out + i, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            }
+            multiplyScalar(a + i, b + i, out + i, n - i);
+        }
+
+        void multiplyAddSse2(const double* a, const double* b, double* c, size_t n) {
+            size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                __m128d product = _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i));
+                _mm_storeu_pd(c + i, _mm_add_pd(_mm_loadu_pd(c + i), product));
+            }
+            multiplyAddScalar(a + i, b + i, c + i, n - i);
+        }
+
+        // Four independent accumulators hide the latency of the additions.
+        double dotSse2(const double* a, const double* b, size_t n) {
+            __m128d sum0 = _mm_setzero_pd(), sum1 = _mm_setzero_pd(), sum2 = _mm_setzero_pd(), sum3 = _mm_setzero_pd();
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+                sum1 = _mm_add_pd(sum1, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+                sum2 = _mm_add_pd(sum2, _mm_mul_pd(_mm_loadu_pd(a + i + 4), _mm_loadu_pd(b + i + 4)));
+                sum3 = _mm_add_pd(sum3, _mm_mul_pd(_mm_loadu_pd(a + i + 6), _mm_loadu_pd(b + i + 6)));
+            }
+            for (; i + 2 <= n; i += 2) {
+                sum0 = _mm_add_pd(sum0, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            }
+
+            sum0 = _mm_add_pd(_mm_add_pd(sum0, sum1), _mm_add_pd(sum2, sum3));
+            return _mm_cvtsd_f64(_mm_add_sd(sum0, _mm_unpackhi_pd(sum0, sum0))) + dotScalar(a + i, b + i, n - i);
+        }
+
+        void addSse2(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            addScalar(a + i, b + i, out + i, n - i);
+        }
+
+        void subSse2(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+            }
+            subScalar(a + i, b + i, out + i, n - i);
+        }
+
+        void scaleSse2(const float* a, float factor, float* out, size_t n) {
+            __m128 f = _mm_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(a + i), f));
+            }
+            scaleScalar(a + i, factor, out + i, n - i);
+        }
+
+        void negateSse2(const float* a, float* out, size_t n) {
+            __m128 sign = _mm_set1_ps(-0.0f);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(out + i, _mm_xor_ps(_mm_loadu_ps(a + i), sign));
+            }
+            negateScalar(a + i, out + i, n - i);
+        }
+
+        bool equalSse2(const float* a, const float* b, size_t n, float eps) {
+            __m128 sign = _mm_set1_ps(-0.0f);
+            __m128 e = _mm_set1_ps(eps);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                __m128 diff = _mm_andnot_ps(sign, _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+                if (_mm_movemask_ps(_mm_cmpge_ps(diff, e))) {
+                    return false;
+                }
+            }
+            return equalScalar(a + i, b + i, n - i, eps);
+        }
+
+        void axpySse2(float factor, const float* x, float* y, size_t n) {
+            __m128 f = _mm_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(_mm_loadu_ps(x + i), f)));
+            }
+            axpyScalar(factor, x + i, y + i, n - i);
+        }
+
+        const Kernels kSse2Kernels = {
+            addSse2, subSse2, scaleSse2, negateSse2, equalSse2, axpySse2, multiplySse2, multiplyAddSse2, dotSse2
+        };
+
+        const FloatKernels kFloatSse2Kernels = {
+            addSse2, subSse2, scaleSse2, negateSse2, equalSse2, axpySse2
+        };
+
+        __attribute__((target("avx2")))
+        void addAvx2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_add_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            }
+            addScalar(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void subAvx2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            }
+            subScalar(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void scaleAvx2(const double* a, double factor, double* out, size_t n) {
+            __m256d f = _mm256_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), f));
+            }
+            scaleScalar(a + i, factor, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void negateAvx2(const double* a, double* out, size_t n) {
+            __m256d sign = _mm256_set1_pd(-0.0);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_xor_pd(_mm256_loadu_pd(a + i), sign));
+            }
+            negateScalar(a + i, out + i, n - i);
+        }
+
+        // Checks two vectors per branch to keep the early exit off the critical path.
+        __attribute__((target("avx2")))
+        bool equalAvx2(const double* a, const double* b, size_t n, double eps) {
+            __m256d sign = _mm256_set1_pd(-0.0);
+            __m256d e = _mm256_set1_pd(eps);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m256d diff0 = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+                __m256d diff1 = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4)));
+                __m256d far = _mm256_or_pd(_mm256_cmp_pd(diff0, e, _CMP_GE_OQ), _mm256_cmp_pd(diff1, e, _CMP_GE_OQ));
+                if (_mm256_movemask_pd(far)) {
+                    return false;
+                }
+            }
+            return equalScalar(a + i, b + i, n - i, eps);
+        }
+
+        __attribute__((target("avx2,fma")))
+        void axpyAvx2(double factor, const double* x, double* y, size_t n) {
+            __m256d f = _mm256_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(y + i, _mm256_fmadd_pd(_mm256_loadu_pd(x + i), f, _mm256_loadu_pd(y + i)));
+            }
+            axpyScalar(factor, x + i, y + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void multiplyAvx2(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+            }
+            multiplyScalar(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2,fma")))
+        void multiplyAddAvx2(const double* a, const double* b, double* c, size_t n) {
+            size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                _mm256_storeu_pd(c + i, _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i)));
+            }
+            multiplyAddScalar(a + i, b + i, c + i, n - i);
+        }
+
+        __attribute__((target("avx2,fma")))
+        double dotAvx2(const double* a, const double* b, size_t n) {
+            __m256d sum0 = _mm256_setzero_pd(), sum1 = _mm256_setzero_pd();
+            __m256d sum2 = _mm256_setzero_pd(), sum3 = _mm256_setzero_pd();
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), sum0);
+                sum1 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 4), _mm256_loadu_pd(b + i + 4), sum1);
+                sum2 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 8), _mm256_loadu_pd(b + i + 8), sum2);
+                sum3 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i + 12), _mm256_loadu_pd(b + i + 12), sum3);
+            }
+            for (; i + 4 <= n; i += 4) {
+                sum0 = _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), sum0);
+            }
+
+            sum0 = _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3));
+            __m128d half = _mm_add_pd(_mm256_castpd256_pd128(sum0), _mm256_extractf128_pd(sum0, 1));
+            return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half))) + dotScalar(a + i, b + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void addAvx2(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            }
+            addScalar(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void subAvx2(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+            }
+            subScalar(a + i, b + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void scaleAvx2(const float* a, float factor, float* out, size_t n) {
+            __m256 f = _mm256_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), f));
+            }
+            scaleScalar(a + i, factor, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        void negateAvx2(const float* a, float* out, size_t n) {
+            __m256 sign = _mm256_set1_ps(-0.0f);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(out + i, _mm256_xor_ps(_mm256_loadu_ps(a + i), sign));
+            }
+            negateScalar(a + i, out + i, n - i);
+        }
+
+        __attribute__((target("avx2")))
+        bool equalAvx2(const float* a, const float* b, size_t n, float eps) {
+            __m256 sign = _mm256_set1_ps(-0.0f);
+            __m256 e = _mm256_set1_ps(eps);
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m256 diff0 = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+                __m256 diff1 = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+                __m256 far = _mm256_or_ps(_mm256_cmp_ps(diff0, e, _CMP_GE_OQ), _mm256_cmp_ps(diff1, e, _CMP_GE_OQ));
+                if (_mm256_movemask_ps(far)) {
+                    return false;
+                }
+            }
+            return equalScalar(a + i, b + i, n - i, eps);
+        }
+
+        __attribute__((target("avx2,fma")))
+        void axpyAvx2(float factor, const float* x, float* y, size_t n) {
+            __m256 f = _mm256_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm256_storeu_ps(y + i, _mm256_fmadd_ps(_mm256_loadu_ps(x + i), f, _mm256_loadu_ps(y + i)));
+            }
+            axpyScalar(factor, x + i, y + i, n - i);
+        }
+
+        const Kernels kAvx2Kernels = {
+            addAvx2, subAvx2, scaleAvx2, negateAvx2, equalAvx2, axpyAvx2, multiplyAvx2, multiplyAddAvx2, dotAvx2
+        };
+
+        const FloatKernels kFloatAvx2Kernels = {
+            addAvx2, subAvx2, scaleAvx2, negateAvx2, equalAvx2, axpyAvx2
+        };
+
+        // AVX-512 handles the tail with masked loads and stores.
+        __attribute__((target("avx512f")))
+        __mmask8 tailMask(size_t n) {
+            return static_cast<__mmask8>((1u << n) - 1);
+        }
+
+        __attribute__((target("avx512f")))
+        __mmask16 floatTailMask(size_t n) {
+            return static_cast<__mmask16>((1u << n) - 1);
+        }
+
+        __attribute__((target("avx512f")))
+        void addAvx512(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_add_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                _mm512_mask_storeu_pd(out + i, m, _mm512_add_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void subAvx512(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                _mm512_mask_storeu_pd(out + i, m, _mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void scaleAvx512(const double* a, double factor, double* out, size_t n) {
+            __m512d f = _mm512_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), f));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                _mm512_mask_storeu_pd(out + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, a + i), f));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void negateAvx512(const double* a, double* out, size_t n) {
+            __m512i sign = _mm512_set1_epi64(static_cast<long long>(1ull << 63));
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                __m512i x = _mm512_castpd_si512(_mm512_loadu_pd(a + i));
+                _mm512_storeu_pd(out + i, _mm512_castsi512_pd(_mm512_xor_si512(x, sign)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                __m512i x = _mm512_castpd_si512(_mm512_maskz_loadu_pd(m, a + i));
+                _mm512_mask_storeu_pd(out + i, m, _mm512_castsi512_pd(_mm512_xor_si512(x, sign)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        bool equalAvx512(const double* a, const double* b, size_t n, double eps) {
+            __m512d e = _mm512_set1_pd(eps);
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m512d diff0 = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+                __m512d diff1 = _mm512_abs_pd(_mm512_sub_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8)));
+                if (_mm512_cmp_pd_mask(diff0, e, _CMP_GE_OQ) | _mm512_cmp_pd_mask(diff1, e, _CMP_GE_OQ)) {
+                    return false;
+                }
+            }
+            for (; i < n; i += 8) {
+                __mmask8 m = n - i >= 8 ? static_cast<__mmask8>(0xFF) : tailMask(n - i);
+                __m512d diff = _mm512_abs_pd(_mm512_sub_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i)));
+                if (_mm512_mask_cmp_pd_mask(m, diff, e, _CMP_GE_OQ)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        __attribute__((target("avx512f")))
+        void axpyAvx512(double factor, const double* x, double* y, size_t n) {
+            __m512d f = _mm512_set1_pd(factor);
+
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(y + i, _mm512_fmadd_pd(_mm512_loadu_pd(x + i), f, _mm512_loadu_pd(y + i)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                _mm512_mask_storeu_pd(y + i, m, _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, x + i), f, _mm512_maskz_loadu_pd(m, y + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void multiplyAvx512(const double* a, const double* b, double* out, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(out + i, _mm512_mul_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                _mm512_mask_storeu_pd(out + i, m, _mm512_mul_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void multiplyAddAvx512(const double* a, const double* b, double* c, size_t n) {
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                _mm512_storeu_pd(c + i, _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), _mm512_loadu_pd(c + i)));
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                __m512d product = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i),
+                                                  _mm512_maskz_loadu_pd(m, c + i));
+                _mm512_mask_storeu_pd(c + i, m, product);
+            }
+        }
+
+        // Masked-off lanes load as zeros and add nothing to the sum.
+        __attribute__((target("avx512f")))
+        double dotAvx512(const double* a, const double* b, size_t n) {
+            __m512d sum0 = _mm512_setzero_pd(), sum1 = _mm512_setzero_pd();
+            __m512d sum2 = _mm512_setzero_pd(), sum3 = _mm512_setzero_pd();
+
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), sum0);
+                sum1 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 8), _mm512_loadu_pd(b + i + 8), sum1);
+                sum2 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 16), _mm512_loadu_pd(b + i + 16), sum2);
+                sum3 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i + 24), _mm512_loadu_pd(b + i + 24), sum3);
+            }
+            for (; i + 8 <= n; i += 8) {
+                sum0 = _mm512_fmadd_pd(_mm512_loadu_pd(a + i), _mm512_loadu_pd(b + i), sum0);
+            }
+            if (i < n) {
+                __mmask8 m = tailMask(n - i);
+                sum1 = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(m, a + i), _mm512_maskz_loadu_pd(m, b + i), sum1);
+            }
+
+            return _mm512_reduce_add_pd(_mm512_add_pd(_mm512_add_pd(sum0, sum1), _mm512_add_pd(sum2, sum3)));
+        }
+
+        __attribute__((target("avx512f")))
+        void addAvx512(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+            }
+            if (i < n) {
+                __mmask16 m = floatTailMask(n - i);
+                _mm512_mask_storeu_ps(out + i, m, _mm512_add_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void subAvx512(const float* a, const float* b, float* out, size_t n) {
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+            }
+            if (i < n) {
+                __mmask16 m = floatTailMask(n - i);
+                _mm512_mask_storeu_ps(out + i, m, _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void scaleAvx512(const float* a, float factor, float* out, size_t n) {
+            __m512 f = _mm512_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(out + i, _mm512_mul_ps(_mm512_loadu_ps(a + i), f));
+            }
+            if (i < n) {
+                __mmask16 m = floatTailMask(n - i);
+                _mm512_mask_storeu_ps(out + i, m, _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i), f));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        void negateAvx512(const float* a, float* out, size_t n) {
+            __m512i sign = _mm512_set1_epi32(static_cast<int>(1u << 31));
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                __m512i x = _mm512_castps_si512(_mm512_loadu_ps(a + i));
+                _mm512_storeu_ps(out + i, _mm512_castsi512_ps(_mm512_xor_si512(x, sign)));
+            }
+            if (i < n) {
+                __mmask16 m = floatTailMask(n - i);
+                __m512i x = _mm512_castps_si512(_mm512_maskz_loadu_ps(m, a + i));
+                _mm512_mask_storeu_ps(out + i, m, _mm512_castsi512_ps(_mm512_xor_si512(x, sign)));
+            }
+        }
+
+        __attribute__((target("avx512f")))
+        bool equalAvx512(const float* a, const float* b, size_t n, float eps) {
+            __m512 e = _mm512_set1_ps(eps);
+
+            size_t i = 0;
+            for (; i + 32 <= n; i += 32) {
+                __m512 diff0 = _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i)));
+                __m512 diff1 = _mm512_abs_ps(_mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16)));
+                if (_mm512_cmp_ps_mask(diff0, e, _CMP_GE_OQ) | _mm512_cmp_ps_mask(diff1, e, _CMP_GE_OQ)) {
+                    return false;
+                }
+            }
+            for (; i < n; i += 16) {
+                __mmask16 m = n - i >= 16 ? static_cast<__mmask16>(0xFFFF) : floatTailMask(n - i);
+                __m512 diff = _mm512_abs_ps(_mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i), _mm512_maskz_loadu_ps(m, b + i)));
+                if (_mm512_mask_cmp_ps_mask(m, diff, e, _CMP_GE_OQ)) {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        __attribute__((target("avx512f")))
+        void axpyAvx512(float factor, const float* x, float* y, size_t n) {
+            __m512 f = _mm512_set1_ps(factor);
+
+            size_t i = 0;
+            for (; i + 16 <= n; i += 16) {
+                _mm512_storeu_ps(y + i, _mm512_fmadd_ps(_mm512_loadu_ps(x + i), f, _mm512_loadu_ps(y + i)));
+            }
+            if (i < n) {
+                __mmask16 m = floatTailMask(n - i);
+                _mm512_mask_storeu_ps(y + i, m, _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, x + i), f, _mm512_maskz_loadu_ps(m, y + i)));
+            }
+        }
+
+        const Kernels kAvx512Kernels = {
+            addAvx512, subAvx512, scaleAvx512, negateAvx512, equalAvx512, axpyAvx512, multiplyAvx512, multiplyAddAvx512,
+            dotAvx512
+        };
+
+        const FloatKernels kFloatAvx512Kernels = {
+            addAvx512, subAvx512, scaleAvx512, negateAvx512, equalAvx512, axpyAvx512
+        };
+
+#endif
+
+        SimdLevel detect() {
+#ifdef TASK_SIMD_X86
+            __builtin_cpu_init();
+
+            if (__builtin_cpu_supports("avx512f")) {
+                return SimdLevel::kAvx512;
+            }
+            // The AVX2 kernels are compiled with FMA as well.
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+                return SimdLevel::kAvx2;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                return SimdLevel::kSse2;
+            }
+#endif
+            return SimdLevel::kScalar;
+        }
+
+        const Kernels* kernelsFor(SimdLevel level) {
+            switch (level) {
+#ifdef TASK_SIMD_X86
+                case SimdLevel::kAvx512:
+                    return &kAvx512Kernels;
+                case SimdLevel::kAvx2:
+                    return &kAvx2Kernels;
+                case SimdLevel::kSse2:
+                    return &kSse2Kernels;
+#endif
+                default:
+                    return &kScalarKernels;
+            }
+        }
+
+        const FloatKernels* floatKernelsFor(SimdLevel level) {
+            switch (level) {
+#ifdef TASK_SIMD_X86
+                case SimdLevel::kAvx512:
+                    return &kFloatAvx512Kernels;
+                case SimdLevel::kAvx2:
+                    return &kFloatAvx2Kernels;
+                case SimdLevel::kSse2:
+                    return &kFloatSse2Kernels;
+#endif
+                default:
+                    return &kFloatScalarKernels;
+            }
+        }
+
+        struct Dispatch {
+            Dispatch()
+                : detected(detect()), level(detected),
+                  kernels(kernelsFor(detected)), float_kernels(floatKernelsFor(detected)) {}
+
+            const SimdLevel detected;
+            std::atomic<SimdLevel> level;
+            std::atomic<const Kernels*> kernels;
+            std::atomic<const FloatKernels*> float_kernels;
+        };
+
+        Dispatch& dispatch() {
+            static Dispatch instance;
+            return instance;
+        }
+
+        const Kernels& kernels() {
+            return *dispatch().kernels.load(std::memory_order_relaxed);
+        }
+
+        const FloatKernels& floatKernels() {
+            return *dispatch().float_kernels.load(std::memory_order_relaxed);
+        }
+
+    }  // namespace
+
+    SimdLevel detectedSimdLevel() {
+        return dispatch().detected;
+    }
+
+    void setSimdLevel(SimdLevel level) {
+        Dispatch& d = dispatch();
+        level = std::min(level, d.detected);
+
+        d.level.store(level, std::memory_order_relaxed);
+        d.kernels.store(kernelsFor(level), std::memory_order_relaxed);
+        d.float_kernels.store(floatKernelsFor(level), std::memory_order_relaxed);
+    }
+
+    SimdLevel simdLevel() {
+        return dispatch().level.load(std::memory_order_relaxed);
+    }
+
+    namespace simd {
+
+        void add(const double* a, const double* b, double* out, size_t n) {
+            kernels().add(a, b, out, n);
+        }
+
+        void sub(const double* a, const double* b, double* out, size_t n) {
+            kernels().sub(a, b, out, n);
+        }
+
+        void scale(const double* a, double factor, double* out, size_t n) {
+            kernels().scale(a, factor, out, n);
+        }
+
+        void negate(const double* a, double* out, size_t n) {
+            kernels().negate(a, out, n);
+        }
+
+        bool equal(const double* a, const double* b, size_t n, double eps) {
+            return kernels().equal(a, b, n, eps);
+        }
+
+        void axpy(double factor, const double* x, double* y, size_t n) {
+            kernels().axpy(factor, x, y, n);
+        }
+
+        void multiply(const double* a, const double* b, double* out, size_t n) {
+            kernels().multiply(a, b, out, n);
+        }
+
+        void multiplyAdd(const double* a, const double* b, double* c, size_t n) {
+            kernels().multiplyAdd(a, b, c, n);
+        }
+
+        double dot(const double* a, const double* b, size_t n) {
+            return kernels().dot(a, b, n);
+        }
+
+        void add(const float* a, const float* b, float* out, size_t n) {
+            floatKernels().add(a, b, out, n);
+        }
+
+        void sub(const float* a, const float* b, float* out, size_t n) {
+            floatKernels().sub(a, b, out, n);
+        }
+
+        void scale(const float* a, float factor, float* out, size_t n) {
+            floatKernels().scale(a, factor, out, n);
+        }
+
+        void negate(const float* a, float* out, size_t n) {
+            floatKernels().negate(a, out, n);
+        }
+
+        bool equal(const float* a, const float* b, size_t n, float eps) {
+            return floatKernels().equal(a, b, n, eps);
+        }
+
+        void axpy(float factor, const float* x, float* y, size_t n) {
+            floatKernels().axpy(factor, x, y, n);
+        }
+
+    }  // namespace simd
+
+}  // namespace task
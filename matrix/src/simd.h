@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+
+namespace task {
+
+enum class SimdLevel {
+    kScalar,
+    kSse2,
+    kAvx2,    // AVX2 with FMA
+    kAvx512,
+};
+
+// Best instruction set supported by the CPU we are running on.
+SimdLevel detectedSimdLevel();
+
+// Kernels in use; defaults to detectedSimdLevel(). Requests above the
+// detected level are clamped to it.
+void setSimdLevel(SimdLevel level);
+SimdLevel simdLevel();
+
+namespace simd {
+
+// Element-wise kernels over n doubles. `out` may alias any of the inputs.
+void add(const double* a, const double* b, double* out, size_t n);
+void sub(const double* a, const double* b, double* out, size_t n);
+void scale(const double* a, double factor, double* out, size_t n);
+void negate(const double* a, double* out, size_t n);
+
+// True if |a[i] - b[i]| < eps for every i; stops at the first mismatch.
+bool equal(const double* a, const double* b, size_t n, double eps);
+
+// y[i] += factor * x[i]; y must not alias x.
+void axpy(double factor, const double* x, double* y, size_t n);
+
+// out[i] = a[i] * b[i], which may alias either input, and c[i] += a[i] * b[i],
+// where c must not alias a or b.
+void multiply(const double* a, const double* b, double* out, size_t n);
+void multiplyAdd(const double* a, const double* b, double* c, size_t n);
+
+// Sum of a[i] * b[i]; the order of summation depends on the level.
+double dot(const double* a, const double* b, size_t n);
+
+// Single-precision versions, with twice as many lanes per vector.
+void add(const float* a, const float* b, float* out, size_t n);
+void sub(const float* a, const float* b, float* out, size_t n);
+void scale(const float* a, float factor, float* out, size_t n);
+void negate(const float* a, float* out, size_t n);
+bool equal(const float* a, const float* b, size_t n, float eps);
+void axpy(float factor, const float* x, float* y, size_t n);
+
+}  // namespace simd
+
+}  // namespace task
@@ -0,0 +1,390 @@
+#include "solvers.h"
+#include "gemm.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace task {
+
+    namespace {
+
+        // Multiply-adds per parallel chunk of sparse rows.
+        const size_t kParallelGrain = 1 << 14;
+
+        double norm(const double* x, size_t n) {
+            return std::sqrt(simd::dot(x, x, n));
+        }
+
+        // z = M^-1 r, or a copy of r without a preconditioner.
+        void precondition(const Preconditioner* preconditioner, const double* r, double* z, size_t n) {
+            if (preconditioner != nullptr) {
+                preconditioner->apply(r, z);
+            } else {
+                std::copy_n(r, n, z);
+            }
+        }
+
+        // r = b - A x
+        void residual(const LinearOperator& a, const std::vector<double>& b, const std::vector<double>& x,
+                      std::vector<double>& r) {
+            a.apply(x.data(), r.data());
+            simd::sub(b.data(), r.data(), r.data(), b.size());
+        }
+
+        // Checks the sizes and sets up the result with the initial guess.
+        // Returns ||b||, or zero if the solution is x = 0 and nothing is left
+        // to do.
+        double start(const LinearOperator& a, const std::vector<double>& b, const SolverOptions& options,
+                     SolverResult& result) {
+            size_t n = a.size();
+            if (b.size() != n || (!options.initial_guess.empty() && options.initial_guess.size() != n)) {
+                throw SizeMismatchException();
+            }
+
+            double b_norm = norm(b.data(), n);
+            if (b_norm == 0.) {
+                result.x.assign(n, 0.);
+                result.converged = true;
+                return 0.;
+            }
+
+            result.x = options.initial_guess.empty() ? std::vector<double>(n, 0.) : options.initial_guess;
+            return b_norm;
+        }
+
+        // Records an iteration; false if the monitor asks to stop.
+        bool record(SolverResult& result, const SolverOptions& options, double residual) {
+            ++result.iterations;
+            result.history.push_back(residual);
+
+            return !options.monitor || options.monitor(IterationStats{ result.iterations, residual });
+        }
+
+        void finish(const LinearOperator& a, const std::vector<double>& b, double b_norm, SolverResult& result) {
+            std::vector<double> r(b.size());
+            residual(a, b, result.x, r);
+            result.residual = norm(r.data(), r.size()) / b_norm;
+        }
+
+    }  // namespace
+
+    MatrixOperator::MatrixOperator(const Matrix& a) : matrix(a) {
+        if (a.size().first != a.size().second) {
+            throw SizeMismatchException();
+        }
+    }
+
+    size_t MatrixOperator::size() const {
+        return this->matrix.size().first;
+    }
+
+    void MatrixOperator::apply(const double* x, double* y) const {
+        gemm::gemv(size(), size(), this->matrix.rawData(), this->matrix.stride(), x, y, defaultExecutionPolicy());
+    }
+
+    SparseOperator::SparseOperator(const SparseMatrix& a) : matrix(a.toCsr()) {
+        if (a.size().first != a.size().second) {
+            throw SizeMismatchException();
+        }
+    }
+
+    size_t SparseOperator::size() const {
+        return this->matrix.size().first;
+    }
+
+    void SparseOperator::apply(const double* x, double* y) const {
+        const std::vector<size_t>& offsets = this->matrix.offsets();
+        const std::vector<size_t>& indices = this->matrix.indices();
+        const std::vector<double>& values = this->matrix.values();
+
+        size_t rows = size();
+        size_t grain = kParallelGrain / (this->matrix.nonZeros() / std::max<size_t>(rows, 1) + 1) + 1;
+        parallelFor(defaultExecutionPolicy(), 0, rows, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                double sum = 0.;
+                for (size_t p = offsets[i]; p < offsets[i + 1]; ++p) {
+                    sum += values[p] * x[indices[p]];
+                }
+                y[i] = sum;
+            }
+        });
+    }
+
+    JacobiPreconditioner::JacobiPreconditioner(const Matrix& a) {
+        if (a.size().first != a.size().second) {
+            throw SizeMismatchException();
+        }
+
+        for (size_t i = 0; i < a.size().first; ++i) {
+            if (std::fabs(a[i][i]) < EPS) {
+                throw SingularMatrixException();
+            }
+            this->inverse_diagonal.push_back(1. / a[i][i]);
+        }
+    }
+
+    JacobiPreconditioner::JacobiPreconditioner(const SparseMatrix& a) {
+        if (a.size().first != a.size().second) {
+            throw SizeMismatchException();
+        }
+
+        for (size_t i = 0; i < a.size().first; ++i) {
+            double value = a.get(i, i);
+            if (std::fabs(value) < EPS) {
+                throw SingularMatrixException();
+            }
+            this->inverse_diagonal.push_back(1. / value);
+        }
+    }
+
+    void JacobiPreconditioner::apply(const double* r, double* z) const {
+        simd::multiply(r, this->inverse_diagonal.data(), z, this->inverse_diagonal.size());
+    }
+
+    IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner(const Matrix& a) :
+            IncompleteCholeskyPreconditioner(SparseMatrix(a)) {}
+
+    // Row by row: L(i, k) = (A(i, k) - sum L(i, j) L(k, j)) / L(k, k) for the
+    // stored k < i, with the sum over the columns j < k stored in both rows,
+    // then L(i, i) = sqrt(A(i, i) - sum L(i, j)^2).
+    IncompleteCholeskyPreconditioner::IncompleteCholeskyPreconditioner(const SparseMatrix& a) {
+        if (a.size().first != a.size().second) {
+            throw SizeMismatchException();
+        }
+
+        SparseMatrix csr = a.toCsr();
+        size_t n = csr.size().first;
+
+        this->offsets.assign(1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            for (size_t p = csr.offsets()[i]; p < csr.offsets()[i + 1] && csr.indices()[p] <= i; ++p) {
+                this->indices.push_back(csr.indices()[p]);
+                this->values.push_back(csr.values()[p]);
+            }
+            if (this->indices.size() == this->offsets.back() || this->indices.back() != i) {
+                throw SingularMatrixException();
+            }
+            this->offsets.push_back(this->indices.size());
+        }
+
+        for (size_t i = 0; i < n; ++i) {
+            size_t diagonal = this->offsets[i + 1] - 1;
+
+            for (size_t p = this->offsets[i]; p < diagonal; ++p) {
+                size_t k = this->indices[p];
+                size_t q = this->offsets[k];
+                size_t k_diagonal = this->offsets[k + 1] - 1;
+
+                double sum = 0.;
+                for (size_t s = this->offsets[i]; s < p && q < k_diagonal;) {
+                    if (this->indices[s] < this->indices[q]) {
+                        ++s;
+                    } else if (this->indices[q] < this->indices[s]) {
+                        ++q;
+                    } else {
+                        sum += this->values[s++] * this->values[q++];
+                    }
+                }
+                this->values[p] = (this->values[p] - sum) / this->values[k_diagonal];
+            }
+
+            double pivot = this->values[diagonal];
+            for (size_t p = this->offsets[i]; p < diagonal; ++p) {
+                pivot -= this->values[p] * this->values[p];
+            }
+            if (!(pivot > 0.)) {
+                throw SingularMatrixException();
+            }
+            this->values[diagonal] = std::sqrt(pivot);
+        }
+    }
+
+    void IncompleteCholeskyPreconditioner::apply(const double* r, double* z) const {
+        size_t n = this->offsets.size() - 1;
+
+        for (size_t i = 0; i < n; ++i) {
+            size_t diagonal = this->offsets[i + 1] - 1;
+            double sum = r[i];
+            for (size_t p = this->offsets[i]; p < diagonal; ++p) {
+                sum -= this->values[p] * z[this->indices[p]];
+            }
+            z[i] = sum / this->values[diagonal];
+        }
+
+        // Row i of L is column i of L^T, so once z[i] is final it is
+        // scattered into the rows above.
+        for (size_t i = n; i-- > 0;) {
+            size_t diagonal = this->offsets[i + 1] - 1;
+            z[i] /= this->values[diagonal];
+            for (size_t p = this->offsets[i]; p < diagonal; ++p) {
+                z[this->indices[p]] -= this->values[p] * z[i];
+            }
+        }
+    }
+
+    SolverResult conjugateGradient(const LinearOperator& a, const std::vector<double>& b,
+                                   const SolverOptions& options, const Preconditioner* preconditioner) {
+        SolverResult result;
+        double b_norm = start(a, b, options, result);
+        if (b_norm == 0.) {
+            return result;
+        }
+
+        size_t n = a.size();
+        double* x = result.x.data();
+        std::vector<double> r(n), z(n), p(n), q(n);
+
+        residual(a, b, result.x, r);
+        result.converged = norm(r.data(), n) / b_norm <= options.tolerance;
+
+        precondition(preconditioner, r.data(), z.data(), n);
+        p = z;
+        double rz = simd::dot(r.data(), z.data(), n);
+
+        while (!result.converged && result.iterations < options.max_iterations) {
+            a.apply(p.data(), q.data());
+
+            // p^T A p <= 0 means A is not positive definite.
+            double pq = simd::dot(p.data(), q.data(), n);
+            if (!(pq > 0.)) {
+                break;
+            }
+
+            double alpha = rz / pq;
+            simd::axpy(alpha, p.data(), x, n);
+            simd::axpy(-alpha, q.data(), r.data(), n);
+
+            double relative = norm(r.data(), n) / b_norm;
+            result.converged = relative <= options.tolerance;
+            if (!record(result, options, relative)) {
+                break;
+            }
+
+            precondition(preconditioner, r.data(), z.data(), n);
+            double rz_next = simd::dot(r.data(), z.data(), n);
+            simd::scale(p.data(), rz_next / rz, p.data(), n);
+            simd::add(p.data(), z.data(), p.data(), n);
+            rz = rz_next;
+        }
+
+        finish(a, b, b_norm, result);
+
+        return result;
+    }
+
+    SolverResult conjugateGradient(const Matrix& a, const std::vector<double>& b,
+                                   const SolverOptions& options, const Preconditioner* preconditioner) {
+        return conjugateGradient(MatrixOperator(a), b, options, preconditioner);
+    }
+
+    // Every cycle builds an orthonormal basis V of the Krylov space of
+    // A M^-1 from the current residual by Arnoldi with modified Gram-Schmidt,
+    // keeping the Hessenberg matrix H triangular with Givens rotations, so
+    // that |g[j]| is the residual norm after j steps. The cycle ends with
+    // x += M^-1 V y, where y solves the triangular system H y = g.
+    SolverResult gmres(const LinearOperator& a, const std::vector<double>& b,
+                       const SolverOptions& options, const Preconditioner* preconditioner) {
+        SolverResult result;
+        double b_norm = start(a, b, options, result);
+        if (b_norm == 0.) {
+            return result;
+        }
+
+        size_t n = a.size();
+        size_t m = std::max<size_t>(1, std::min(options.restart, n));
+        std::vector<double> basis((m + 1) * n), r(n), w(n), z(n);
+        std::vector<double> h((m + 1) * m), cosines(m), sines(m), g(m + 1), y(m);
+
+        auto v = [&](size_t i) {
+            return basis.data() + i * n;
+        };
+
+        residual(a, b, result.x, r);
+        double beta = norm(r.data(), n);
+        result.converged = beta / b_norm <= options.tolerance;
+        bool stop = false;
+
+        while (!result.converged && !stop && result.iterations < options.max_iterations) {
+            simd::scale(r.data(), 1. / beta, v(0), n);
+            std::fill(g.begin(), g.end(), 0.);
+            g[0] = beta;
+
+            size_t j = 0;
+            while (j < m && result.iterations < options.max_iterations) {
+                precondition(preconditioner, v(j), z.data(), n);
+                a.apply(z.data(), w.data());
+
+                for (size_t i = 0; i <= j; ++i) {
+                    h[i * m + j] = simd::dot(w.data(), v(i), n);
+                    simd::axpy(-h[i * m + j], v(i), w.data(), n);
+                }
+                double next = norm(w.data(), n);
+
+                for (size_t i = 0; i < j; ++i) {
+                    double upper = h[i * m + j];
+                    double lower = h[(i + 1) * m + j];
+                    h[i * m + j] = cosines[i] * upper + sines[i] * lower;
+                    h[(i + 1) * m + j] = -sines[i] * upper + cosines[i] * lower;
+                }
+
+                double diagonal = std::hypot(h[j * m + j], next);
+                if (diagonal == 0.) {
+                    // A M^-1 maps v(j) into the span of the previous vectors.
+                    stop = true;
+                    break;
+                }
+                cosines[j] = h[j * m + j] / diagonal;
+                sines[j] = next / diagonal;
+                h[j * m + j] = diagonal;
+                g[j + 1] = -sines[j] * g[j];
+                g[j] *= cosines[j];
+                ++j;
+
+                double relative = std::fabs(g[j]) / b_norm;
+                if (!record(result, options, relative)) {
+                    stop = true;
+                    break;
+                }
+                if (relative <= options.tolerance || next == 0.) {
+                    break;
+                }
+                simd::scale(w.data(), 1. / next, v(j), n);
+            }
+
+            for (size_t i = j; i-- > 0;) {
+                double sum = g[i];
+                for (size_t l = i + 1; l < j; ++l) {
+                    sum -= h[i * m + l] * y[l];
+                }
+                y[i] = sum / h[i * m + i];
+            }
+
+            std::fill(w.begin(), w.end(), 0.);
+            for (size_t i = 0; i < j; ++i) {
+                simd::axpy(y[i], v(i), w.data(), n);
+            }
+            precondition(preconditioner, w.data(), z.data(), n);
+            simd::add(result.x.data(), z.data(), result.x.data(), n);
+
+            // Restart from the true residual, which rounding may have moved
+            // away from the estimate.
+            residual(a, b, result.x, r);
+            beta = norm(r.data(), n);
+            result.converged = beta / b_norm <= options.tolerance;
+            if (j == 0) {
+                break;
+            }
+        }
+
+        finish(a, b, b_norm, result);
+
+        return result;
+    }
+
+    SolverResult gmres(const Matrix& a, const std::vector<double>& b,
+                       const SolverOptions& options, const Preconditioner* preconditioner) {
+        return gmres(MatrixOperator(a), b, options, preconditioner);
+    }
+
+}  // namespace task
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "matrix.h"
+#include "sparse.h"
+
+
+namespace task {
+
+// A square linear map y = A x. Solvers only ever apply the operator, so it
+// can be a dense or sparse matrix or a matrix-free product.
+class LinearOperator {
+public:
+    virtual ~LinearOperator() = default;
+
+    virtual size_t size() const = 0;
+
+    // x and y hold size() elements and do not alias.
+    virtual void apply(const double* x, double* y) const = 0;
+};
+
+// Applies a dense matrix with gemm::gemv(). Keeps a reference, so the matrix
+// must outlive the operator. Throws SizeMismatchException if it is not square.
+class MatrixOperator : public LinearOperator {
+public:
+    explicit MatrixOperator(const Matrix& a);
+
+    size_t size() const override;
+    void apply(const double* x, double* y) const override;
+
+private:
+    const Matrix& matrix;
+};
+
+// Applies a copy of the matrix in CSR format, so the cost of a product is
+// linear in the number of non-zeros. Throws SizeMismatchException if it is
+// not square.
+class SparseOperator : public LinearOperator {
+public:
+    explicit SparseOperator(const SparseMatrix& a);
+
+    size_t size() const override;
+    void apply(const double* x, double* y) const override;
+
+private:
+    SparseMatrix matrix;
+};
+
+// Approximates the inverse of A: z = M^-1 r.
+class Preconditioner {
+public:
+    virtual ~Preconditioner() = default;
+
+    // r and z hold as many elements as the operator and do not alias.
+    virtual void apply(const double* r, double* z) const = 0;
+};
+
+// M = diag(A). Throws SingularMatrixException if a diagonal element is
+// below EPS in magnitude and SizeMismatchException if A is not square.
+class JacobiPreconditioner : public Preconditioner {
+public:
+    explicit JacobiPreconditioner(const Matrix& a);
+    explicit JacobiPreconditioner(const SparseMatrix& a);
+
+    void apply(const double* r, double* z) const override;
+
+private:
+    std::vector<double> inverse_diagonal;
+};
+
+// Zero fill-in incomplete Cholesky, M = L L^T where L has the sparsity of
+// the lower triangle of A, which must be symmetric positive definite; only
+// that triangle is read. Dense matrices are taken with the elements of
+// magnitude EPS and above. Throws SingularMatrixException if a pivot is not
+// positive, which may happen even for some positive definite matrices, and
+// SizeMismatchException if A is not square.
+class IncompleteCholeskyPreconditioner : public Preconditioner {
+public:
+    explicit IncompleteCholeskyPreconditioner(const Matrix& a);
+    explicit IncompleteCholeskyPreconditioner(const SparseMatrix& a);
+
+    // Forward substitution with L, then backward with L^T.
+    void apply(const double* r, double* z) const override;
+
+private:
+    // Rows of L in CSR format, the diagonal last in every row.
+    std::vector<size_t> offsets;
+    std::vector<size_t> indices;
+    std::vector<double> values;
+};
+
+// Passed to the monitor after every iteration.
+struct IterationStats {
+    size_t iteration;
+    // ||b - A x|| / ||b|| for the current x; GMRES reports the estimate
+    // from its least-squares problem, which is exact in exact arithmetic.
+    double residual;
+};
+
+struct SolverOptions {
+    // Stop once the relative residual ||b - A x|| / ||b|| is this small.
+    double tolerance = 1e-10;
+    size_t max_iterations = 1000;
+
+    // GMRES only: Krylov basis size between restarts.
+    size_t restart = 30;
+
+    // Starting point; zeros if empty.
+    std::vector<double> initial_guess;
+
+    // Called after every iteration; returning false stops the solver.
+    std::function<bool(const IterationStats&)> monitor;
+};
+
+struct SolverResult {
+    std::vector<double> x;
+    bool converged = false;
+    size_t iterations = 0;
+    // Relative residual after each iteration.
+    std::vector<double> history;
+
+    // Relative residual of the returned x, recomputed as ||b - A x|| / ||b||.
+    double residual = 0.;
+};
+
+// Preconditioned conjugate gradient for symmetric positive definite A; the
+// preconditioner must be symmetric positive definite too. Stops without
+// convergence if a search direction shows that A is not positive definite.
+//
+// Both solvers throw SizeMismatchException if b or the initial guess do not
+// match the operator size. A null preconditioner means none.
+SolverResult conjugateGradient(const LinearOperator& a, const std::vector<double>& b,
+                               const SolverOptions& options = SolverOptions(),
+                               const Preconditioner* preconditioner = nullptr);
+SolverResult conjugateGradient(const Matrix& a, const std::vector<double>& b,
+                               const SolverOptions& options = SolverOptions(),
+                               const Preconditioner* preconditioner = nullptr);
+
+// Restarted GMRES(options.restart) with right preconditioning for any
+// non-singular A, so the residual it minimizes is that of the original
+// system. Needs (restart + 1) * size() doubles for the Krylov basis.
+SolverResult gmres(const LinearOperator& a, const std::vector<double>& b,
+                   const SolverOptions& options = SolverOptions(),
+                   const Preconditioner* preconditioner = nullptr);
+SolverResult gmres(const Matrix& a, const std::vector<double>& b,
+                   const SolverOptions& options = SolverOptions(),
+                   const Preconditioner* preconditioner = nullptr);
+
+}  // namespace task
@@ -0,0 +1,383 @@
+#include "sparse.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace task {
+
+    namespace {
+
+        // Stored elements per parallel chunk of rows.
+        const size_t kParallelGrain = 1 << 14;
+
+        size_t rowGrain(size_t non_zeros, size_t rows) {
+            return kParallelGrain / (non_zeros / std::max<size_t>(rows, 1) + 1) + 1;
+        }
+
+    }  // namespace
+
+    SparseMatrix::SparseMatrix() : SparseMatrix(1, 1) {}
+
+    SparseMatrix::SparseMatrix(size_t rows, size_t cols, SparseFormat format) :
+            dim_size(rows, cols), layout(format), major_offsets(majorSize() + 1, 0) {}
+
+    SparseMatrix::SparseMatrix(const Matrix& dense, SparseFormat format, double threshold) :
+            SparseMatrix(dense.size().first, dense.size().second) {
+        auto[rows, cols] = this->dim_size;
+
+        for (size_t i = 0; i < rows; ++i) {
+            const double* row = dense.rawData() + i * dense.stride();
+
+            for (size_t j = 0; j < cols; ++j) {
+                if (std::fabs(row[j]) >= threshold) {
+                    this->minor_indices.push_back(j);
+                    this->elements.push_back(row[j]);
+                }
+            }
+            this->major_offsets[i + 1] = this->elements.size();
+        }
+
+        if (format == SparseFormat::kCsc) {
+            *this = converted();
+        }
+    }
+
+    SparseMatrix SparseMatrix::fromTriplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets,
+                                            SparseFormat format) {
+        for (const auto& triplet : triplets) {
+            if (triplet.row >= rows || triplet.col >= cols) {
+                throw OutOfBoundsException();
+            }
+        }
+
+        // Bucket by row, then sort each row by column and sum duplicates.
+        SparseMatrix result(rows, cols);
+        for (const auto& triplet : triplets) {
+            ++result.major_offsets[triplet.row + 1];
+        }
+        for (size_t i = 0; i < rows; ++i) {
+            result.major_offsets[i + 1] += result.major_offsets[i];
+        }
+
+        std::vector<std::pair<size_t, double>> entries(triplets.size());
+        std::vector<size_t> next(result.major_offsets.begin(), result.major_offsets.end() - 1);
+        for (const auto& triplet : triplets) {
+            entries[next[triplet.row]++] = { triplet.col, triplet.value };
+        }
+
+        std::vector<size_t> offsets(rows + 1, 0);
+        for (size_t i = 0; i < rows; ++i) {
+            auto begin = entries.begin() + result.major_offsets[i];
+            auto end = entries.begin() + result.major_offsets[i + 1];
+            std::sort(begin, end, [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            for (auto it = begin; it != end; ++it) {
+                if (result.elements.size() > offsets[i] && result.minor_indices.back() == it->first) {
+                    result.elements.back() += it->second;
+                } else {
+                    result.minor_indices.push_back(it->first);
+                    result.elements.push_back(it->second);
+                }
+            }
+            offsets[i + 1] = result.elements.size();
+        }
+        result.major_offsets = std::move(offsets);
+
+        return format == SparseFormat::kCsc ? result.converted() : result;
+    }
+
+    Matrix SparseMatrix::toDense() const {
+        Matrix result(this->dim_size.first, this->dim_size.second);
+        result.view().fill(0.);
+
+        double* data = result.rawData();
+        size_t stride = result.stride();
+        bool csr = this->layout == SparseFormat::kCsr;
+
+        for (size_t m = 0; m < majorSize(); ++m) {
+            for (size_t p = this->major_offsets[m]; p < this->major_offsets[m + 1]; ++p) {
+                size_t i = csr ? m : this->minor_indices[p];
+                size_t j = csr ? this->minor_indices[p] : m;
+                data[i * stride + j] = this->elements[p];
+            }
+        }
+
+        return result;
+    }
+
+    SparseFormat SparseMatrix::format() const {
+        return this->layout;
+    }
+
+    SparseMatrix SparseMatrix::toCsr() const {
+        return this->layout == SparseFormat::kCsr ? *this : converted();
+    }
+
+    SparseMatrix SparseMatrix::toCsc() const {
+        return this->layout == SparseFormat::kCsc ? *this : converted();
+    }
+
+    SparseMatrix SparseMatrix::converted() const {
+        SparseMatrix result(this->dim_size.first, this->dim_size.second,
+                            this->layout == SparseFormat::kCsr ? SparseFormat::kCsc : SparseFormat::kCsr);
+        size_t count = nonZeros();
+
+        for (size_t p = 0; p < count; ++p) {
+            ++result.major_offsets[this->minor_indices[p] + 1];
+        }
+        for (size_t m = 0; m < minorSize(); ++m) {
+            result.major_offsets[m + 1] += result.major_offsets[m];
+        }
+
+        // Visiting the old major index in order keeps every new list sorted.
+        result.minor_indices.resize(count);
+        result.elements.resize(count);
+        std::vector<size_t> next(result.major_offsets.begin(), result.major_offsets.end() - 1);
+
+        for (size_t m = 0; m < majorSize(); ++m) {
+            for (size_t p = this->major_offsets[m]; p < this->major_offsets[m + 1]; ++p) {
+                size_t q = next[this->minor_indices[p]]++;
+                result.minor_indices[q] = m;
+                result.elements[q] = this->elements[p];
+            }
+        }
+
+        return result;
+    }
+
+    std::pair<size_t, size_t> SparseMatrix::size() const {
+        return this->dim_size;
+    }
+
+    size_t SparseMatrix::nonZeros() const {
+        return this->elements.size();
+    }
+
+    double SparseMatrix::density() const {
+        size_t total = this->dim_size.first * this->dim_size.second;
+        return total == 0 ? 0. : static_cast<double>(nonZeros()) / total;
+    }
+
+    double SparseMatrix::get(size_t row, size_t col) const {
+        if (row >= this->dim_size.first || col >= this->dim_size.second) {
+            throw OutOfBoundsException();
+        }
+
+        size_t major = this->layout == SparseFormat::kCsr ? row : col;
+        size_t minor = this->layout == SparseFormat::kCsr ? col : row;
+
+        auto begin = this->minor_indices.begin() + this->major_offsets[major];
+        auto end = this->minor_indices.begin() + this->major_offsets[major + 1];
+        auto it = std::lower_bound(begin, end, minor);
+
+        return it != end && *it == minor ? this->elements[it - this->minor_indices.begin()] : 0.;
+    }
+
+    std::vector<double> SparseMatrix::operator*(const std::vector<double>& x) const {
+        if (x.size() != this->dim_size.second) {
+            throw SizeMismatchException();
+        }
+
+        size_t rows = this->dim_size.first;
+        std::vector<double> result(rows, 0.);
+
+        if (this->layout == SparseFormat::kCsc) {
+            for (size_t j = 0; j < this->dim_size.second; ++j) {
+                for (size_t p = this->major_offsets[j]; p < this->major_offsets[j + 1]; ++p) {
+                    result[this->minor_indices[p]] += this->elements[p] * x[j];
+                }
+            }
+
+            return result;
+        }
+
+        parallelFor(defaultExecutionPolicy(), 0, rows, rowGrain(nonZeros(), rows), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                double sum = 0.;
+                for (size_t p = this->major_offsets[i]; p < this->major_offsets[i + 1]; ++p) {
+                    sum += this->elements[p] * x[this->minor_indices[p]];
+                }
+                result[i] = sum;
+            }
+        });
+
+        return result;
+    }
+
+    // Row i of the result is the sum of value * row k of `a` over the stored
+    // elements (i, k), so only stored elements cost anything and every dense
+    // access is a contiguous axpy. CSC operands are converted first, which
+    // is linear in the number of non-zeros.
+    Matrix SparseMatrix::operator*(const Matrix& a) const {
+        if (this->dim_size.second != a.size().first) {
+            throw SizeMismatchException();
+        }
+
+        if (this->layout == SparseFormat::kCsc) {
+            return converted() * a;
+        }
+
+        size_t rows = this->dim_size.first;
+        size_t cols = a.size().second;
+        Matrix result(rows, cols);
+        result.view().fill(0.);
+
+        const double* b = a.rawData();
+        size_t ldb = a.stride();
+        double* c = result.rawData();
+        size_t ldc = result.stride();
+
+        size_t grain = rowGrain(nonZeros() * cols, rows);
+        parallelFor(defaultExecutionPolicy(), 0, rows, grain, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t p = this->major_offsets[i]; p < this->major_offsets[i + 1]; ++p) {
+                    simd::axpy(this->elements[p], b + this->minor_indices[p] * ldb, c + i * ldc, cols);
+                }
+            }
+        });
+
+        return result;
+    }
+
+    template <class Combine>
+    SparseMatrix SparseMatrix::merge(const SparseMatrix& a, Combine combine) const {
+        if (this->dim_size != a.dim_size) {
+            throw SizeMismatchException();
+        }
+        if (a.layout != this->layout) {
+            return merge(a.converted(), combine);
+        }
+
+        SparseMatrix result(this->dim_size.first, this->dim_size.second, this->layout);
+        result.minor_indices.reserve(nonZeros() + a.nonZeros());
+        result.elements.reserve(nonZeros() + a.nonZeros());
+
+        auto append = [&result](size_t index, double value) {
+            if (value != 0.) {
+                result.minor_indices.push_back(index);
+                result.elements.push_back(value);
+            }
+        };
+
+        for (size_t m = 0; m < majorSize(); ++m) {
+            size_t p = this->major_offsets[m], p_end = this->major_offsets[m + 1];
+            size_t q = a.major_offsets[m], q_end = a.major_offsets[m + 1];
+
+            while (p < p_end || q < q_end) {
+                size_t left = p < p_end ? this->minor_indices[p] : minorSize();
+                size_t right = q < q_end ? a.minor_indices[q] : minorSize();
+
+                if (left < right) {
+                    append(left, combine(this->elements[p++], 0.));
+                } else if (right < left) {
+                    append(right, combine(0., a.elements[q++]));
+                } else {
+                    append(left, combine(this->elements[p++], a.elements[q++]));
+                }
+            }
+            result.major_offsets[m + 1] = result.elements.size();
+        }
+
+        return result;
+    }
+
+    SparseMatrix SparseMatrix::operator+(const SparseMatrix& a) const {
+        return merge(a, [](double x, double y) { return x + y; });
+    }
+
+    SparseMatrix SparseMatrix::operator-(const SparseMatrix& a) const {
+        return merge(a, [](double x, double y) { return x - y; });
+    }
+
+    SparseMatrix SparseMatrix::operator*(const double& number) const {
+        SparseMatrix result(*this);
+        simd::scale(result.elements.data(), number, result.elements.data(), result.elements.size());
+        return result;
+    }
+
+    SparseMatrix SparseMatrix::operator-() const {
+        SparseMatrix result(*this);
+        simd::negate(result.elements.data(), result.elements.data(), result.elements.size());
+        return result;
+    }
+
+    SparseMatrix SparseMatrix::transposed() const {
+        SparseMatrix result(*this);
+        std::swap(result.dim_size.first, result.dim_size.second);
+        result.layout = this->layout == SparseFormat::kCsr ? SparseFormat::kCsc : SparseFormat::kCsr;
+        return result;
+    }
+
+    bool SparseMatrix::operator==(const SparseMatrix& a) const {
+        if (this->dim_size != a.dim_size) {
+            return false;
+        }
+
+        const std::vector<double>& difference = (*this - a).elements;
+        return std::all_of(difference.begin(), difference.end(), [](double value) {
+            return std::fabs(value) < EPS;
+        });
+    }
+
+    bool SparseMatrix::operator!=(const SparseMatrix& a) const {
+        return !(*this == a);
+    }
+
+    const std::vector<size_t>& SparseMatrix::offsets() const {
+        return this->major_offsets;
+    }
+
+    const std::vector<size_t>& SparseMatrix::indices() const {
+        return this->minor_indices;
+    }
+
+    const std::vector<double>& SparseMatrix::values() const {
+        return this->elements;
+    }
+
+    size_t SparseMatrix::majorSize() const {
+        return this->layout == SparseFormat::kCsr ? this->dim_size.first : this->dim_size.second;
+    }
+
+    size_t SparseMatrix::minorSize() const {
+        return this->layout == SparseFormat::kCsr ? this->dim_size.second : this->dim_size.first;
+    }
+
+    SparseMatrix operator*(const double& number, const SparseMatrix& a) {
+        return a * number;
+    }
+
+    double density(const Matrix& dense, double threshold) {
+        auto[rows, cols] = dense.size();
+        size_t count = 0;
+
+        for (size_t i = 0; i < rows; ++i) {
+            const double* row = dense.rawData() + i * dense.stride();
+            count += std::count_if(row, row + cols, [threshold](double value) {
+                return std::fabs(value) >= threshold;
+            });
+        }
+
+        return rows * cols == 0 ? 0. : static_cast<double>(count) / (rows * cols);
+    }
+
+    bool isSparse(const Matrix& dense, double max_density) {
+        return density(dense) <= max_density;
+    }
+
+    std::ostream& operator<<(std::ostream& output, const SparseMatrix& matrix) {
+        bool csr = matrix.format() == SparseFormat::kCsr;
+        const auto& offsets = matrix.offsets();
+
+        for (size_t m = 0; m + 1 < offsets.size(); ++m) {
+            for (size_t p = offsets[m]; p < offsets[m + 1]; ++p) {
+                size_t minor = matrix.indices()[p];
+                output << (csr ? m : minor) << " " << (csr ? minor : m) << " " << matrix.values()[p] << "\n";
+            }
+        }
+
+        return output;
+    }
+
+}  // namespace task
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "matrix.h"
+
+
+namespace task {
+
+// CSR stores the non-zeros row by row, CSC column by column.
+enum class SparseFormat {
+    kCsr,
+    kCsc,
+};
+
+// Sparse matrix of doubles in compressed row or column storage. Only the
+// non-zero elements are stored: for the major index m (the row under CSR,
+// the column under CSC) the minor indices of its non-zeros, in increasing
+// order, are indices()[offsets()[m]] up to indices()[offsets()[m + 1]], with
+// their values at the same positions of values().
+//
+// Unlike Matrix, a SparseMatrix constructed from a size is all zeros.
+class SparseMatrix {
+public:
+    struct Triplet {
+        size_t row;
+        size_t col;
+        double value;
+    };
+
+    // Default density below which isSparse() considers a dense matrix worth
+    // converting.
+    static constexpr double kMaxDensity = 0.1;
+
+    SparseMatrix();
+    SparseMatrix(size_t rows, size_t cols, SparseFormat format = SparseFormat::kCsr);
+
+    // Keeps the elements of `dense` with |value| >= threshold.
+    explicit SparseMatrix(const Matrix& dense, SparseFormat format = SparseFormat::kCsr, double threshold = EPS);
+
+    // Triplets may come in any order; duplicates are summed. Throws
+    // OutOfBoundsException for a triplet outside the matrix.
+    static SparseMatrix fromTriplets(size_t rows, size_t cols, const std::vector<Triplet>& triplets,
+                                     SparseFormat format = SparseFormat::kCsr);
+
+    Matrix toDense() const;
+
+    SparseFormat format() const;
+    SparseMatrix toCsr() const;
+    SparseMatrix toCsc() const;
+
+    std::pair<size_t, size_t> size() const;
+    size_t nonZeros() const;
+    double density() const;
+
+    // Zero for elements that are not stored; throws OutOfBoundsException
+    // outside the matrix.
+    double get(size_t row, size_t col) const;
+
+    // Sparse times dense. Throw SizeMismatchException unless the sizes agree.
+    std::vector<double> operator*(const std::vector<double>& x) const;
+    Matrix operator*(const Matrix& a) const;
+
+    // Results are in the format of the left operand; elements that cancel
+    // to exactly zero are dropped.
+    SparseMatrix operator+(const SparseMatrix& a) const;
+    SparseMatrix operator-(const SparseMatrix& a) const;
+    SparseMatrix operator*(const double& number) const;
+    SparseMatrix operator-() const;
+
+    // The CSR arrays of a matrix are the CSC arrays of its transpose, so this
+    // copies them and flips the format; toCsr() or toCsc() afterwards gives
+    // the other layout.
+    SparseMatrix transposed() const;
+
+    // Equal up to EPS, element by element, whatever the formats.
+    bool operator==(const SparseMatrix& a) const;
+    bool operator!=(const SparseMatrix& a) const;
+
+    const std::vector<size_t>& offsets() const;
+    const std::vector<size_t>& indices() const;
+    const std::vector<double>& values() const;
+
+private:
+    size_t majorSize() const;
+    size_t minorSize() const;
+
+    // Same elements in the other format, by a counting sort on the minor index.
+    SparseMatrix converted() const;
+
+    template <class Combine>
+    SparseMatrix merge(const SparseMatrix& a, Combine combine) const;
+
+    std::pair<size_t, size_t> dim_size;
+    SparseFormat layout;
+    std::vector<size_t> major_offsets;
+    std::vector<size_t> minor_indices;
+    std::vector<double> elements;
+};
+
+SparseMatrix operator*(const double& number, const SparseMatrix& a);
+
+// Fraction of the elements of `dense` with |value| >= threshold.
+double density(const Matrix& dense, double threshold = EPS);
+
+// True if `dense` is sparse enough to be worth converting.
+bool isSparse(const Matrix& dense, double max_density = SparseMatrix::kMaxDensity);
+
+// One "row col value" line per stored element, in storage order.
+std::ostream& operator<<(std::ostream& output, const SparseMatrix& matrix);
+
+}  // namespace task
@@ -0,0 +1,181 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace task {
+
+    namespace {
+
+        std::atomic<ExecutionPolicy> default_policy(ExecutionPolicy::kSequential);
+
+        // Set while the current thread is running a pool task.
+        thread_local bool inside_task = false;
+
+        // Chunks per thread: enough slack for stealing to even out the load.
+        const size_t kChunksPerThread = 4;
+
+    }  // namespace
+
+    void setDefaultExecutionPolicy(ExecutionPolicy policy) {
+        default_policy.store(policy, std::memory_order_relaxed);
+    }
+
+    ExecutionPolicy defaultExecutionPolicy() {
+        return default_policy.load(std::memory_order_relaxed);
+    }
+
+    ThreadPool::ThreadPool(size_t threads) : queued(0), stopping(false) {
+        start(threads > 1 ? threads - 1 : 0);
+    }
+
+    ThreadPool::~ThreadPool() {
+        stop();
+    }
+
+    ThreadPool& ThreadPool::instance() {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()));
+        return pool;
+    }
+
+    size_t ThreadPool::threadCount() const {
+        return this->workers.size() + 1;
+    }
+
+    void ThreadPool::setThreadCount(size_t threads) {
+        stop();
+        start(threads > 1 ? threads - 1 : 0);
+    }
+
+    void ThreadPool::start(size_t count) {
+        this->stopping = false;
+
+        for (size_t i = 0; i < count; ++i) {
+            this->queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < count; ++i) {
+            this->workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    void ThreadPool::stop() {
+        {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->stopping = true;
+        }
+        this->wake.notify_all();
+
+        for (auto& worker : this->workers) {
+            worker.join();
+        }
+
+        this->workers.clear();
+        this->queues.clear();
+    }
+
+    void ThreadPool::run(const Task& task) {
+        bool was_inside = inside_task;
+        inside_task = true;
+
+        (*task.body)(task.begin, task.end);
+
+        inside_task = was_inside;
+        task.pending->fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    bool ThreadPool::tryRun(size_t home) {
+        size_t count = this->queues.size();
+
+        for (size_t offset = 0; offset < count; ++offset) {
+            size_t index = (home + offset) % count;
+            Queue& queue = *this->queues[index];
+            Task task;
+
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty()) {
+                    continue;
+                }
+
+                if (offset == 0) {
+                    task = queue.tasks.back();
+                    queue.tasks.pop_back();
+                } else {
+                    task = queue.tasks.front();
+                    queue.tasks.pop_front();
+                }
+            }
+
+            this->queued.fetch_sub(1, std::memory_order_relaxed);
+            run(task);
+            return true;
+        }
+
+        return false;
+    }
+
+    void ThreadPool::workerLoop(size_t index) {
+        while (true) {
+            if (tryRun(index)) {
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(this->sleep_mutex);
+            this->wake.wait(lock, [this] {
+                return this->stopping || this->queued.load(std::memory_order_relaxed) > 0;
+            });
+
+            if (this->stopping && this->queued.load(std::memory_order_relaxed) == 0) {
+                return;
+            }
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t begin, size_t end, size_t grain, const Body& body) {
+        if (begin >= end) {
+            return;
+        }
+
+        grain = std::max<size_t>(grain, 1);
+        size_t chunks = std::min((end - begin + grain - 1) / grain, threadCount() * kChunksPerThread);
+
+        if (chunks <= 1 || this->workers.empty() || inside_task) {
+            body(begin, end);
+            return;
+        }
+
+        std::atomic<size_t> pending(chunks);
+
+        // Counted up front so that a worker popping a chunk early never sees
+        // the counter drop below zero.
+        {
+            std::lock_guard<std::mutex> lock(this->sleep_mutex);
+            this->queued.fetch_add(chunks, std::memory_order_relaxed);
+        }
+
+        size_t step = (end - begin) / chunks;
+        size_t extra = (end - begin) % chunks;
+
+        size_t chunk_begin = begin;
+        for (size_t i = 0; i < chunks; ++i) {
+            size_t chunk_end = chunk_begin + step + (i < extra ? 1 : 0);
+            Queue& queue = *this->queues[i % this->queues.size()];
+
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(Task{ &body, chunk_begin, chunk_end, &pending });
+            }
+
+            chunk_begin = chunk_end;
+        }
+
+        this->wake.notify_all();
+
+        // The caller steals too instead of sleeping while the workers run.
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (!tryRun(0)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+}  // namespace task
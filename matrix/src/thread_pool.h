@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace task {
+
+enum class ExecutionPolicy {
+    kSequential,
+    kParallel,
+};
+
+// Policy of Matrix operations that are not given one explicitly.
+// Defaults to kSequential.
+void setDefaultExecutionPolicy(ExecutionPolicy policy);
+ExecutionPolicy defaultExecutionPolicy();
+
+// Fixed set of workers, each with its own task deque. Workers pop their own
+// deque from the back and steal from the front of the others when it runs dry.
+class ThreadPool {
+public:
+    // Non-owning reference to a body(chunk_begin, chunk_end) callable. Unlike
+    // std::function it never allocates; the callable must outlive the call.
+    class Body {
+    public:
+        template <class F, class = std::enable_if_t<!std::is_same<std::decay_t<F>, Body>::value>>
+        Body(const F& body) : object(&body), call(&invoke<F>) {}
+
+        void operator()(size_t begin, size_t end) const {
+            this->call(this->object, begin, end);
+        }
+
+    private:
+        template <class F>
+        static void invoke(const void* object, size_t begin, size_t end) {
+            (*static_cast<const F*>(object))(begin, end);
+        }
+
+        const void* object;
+        void (*call)(const void*, size_t, size_t);
+    };
+
+    explicit ThreadPool(size_t threads);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    // Pool shared by all Matrix operations, sized to the hardware concurrency.
+    static ThreadPool& instance();
+
+    // Threads taking part in parallelFor, the calling thread included.
+    // Must not be changed while parallel work is in flight.
+    size_t threadCount() const;
+    void setThreadCount(size_t threads);
+
+    // Splits [begin, end) into chunks of at least `grain` indices, runs
+    // body(chunk_begin, chunk_end) on the pool and the calling thread and
+    // returns once every chunk is done. Calls from inside a task run inline.
+    // `body` must not throw.
+    void parallelFor(size_t begin, size_t end, size_t grain, const Body& body);
+
+private:
+    struct Task {
+        const Body* body;
+        size_t begin;
+        size_t end;
+        std::atomic<size_t>* pending;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void start(size_t workers);
+    void stop();
+    void workerLoop(size_t index);
+    bool tryRun(size_t home);
+    void run(const Task& task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<size_t> queued;
+    bool stopping;
+};
+
+// Runs body over [begin, end) on the shared pool when `policy` is kParallel
+// and the range spans at least two grains, otherwise inline.
+template <class F>
+void parallelFor(ExecutionPolicy policy, size_t begin, size_t end, size_t grain, const F& body) {
+    if (begin >= end) {
+        return;
+    }
+
+    if (policy == ExecutionPolicy::kSequential || end - begin < 2 * (grain > 1 ? grain : 1)) {
+        body(begin, end);
+        return;
+    }
+
+    ThreadPool::instance().parallelFor(begin, end, grain, body);
+}
+
+}  // namespace task
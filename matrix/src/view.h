@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "matrix.h"
+#include "expression.h"
+#include "simd.h"
+
+
+namespace task {
+
+// Non-owning views of a rectangular part of a matrix. A view is a pointer to
+// its first element, its dimensions and the row stride of the matrix, so
+// taking one never allocates or copies. Views are valid as long as the
+// matrix they look into is not resized, transposed in place or destroyed.
+//
+// Views are leaves of the expression templates: they can be read in
+// arithmetic (`Matrix sum = m.row(0) + m.row(1)`), and mutable views can be
+// assigned through (`m.column(2) -= m.column(0) * 2.0`). Assigning one view
+// to another copies elements, it does not rebind the view.
+//
+// T is `double` for mutable views and `const double` for read-only ones.
+template <class T>
+class BasicMatrixView : public expr::Node {
+public:
+    BasicMatrixView(T* data, size_t rows, size_t cols, size_t stride)
+        : data(data), dim_size(rows, cols), row_stride(stride) {}
+
+    BasicMatrixView(const BasicMatrixView& other) = default;
+
+    // Mutable views convert to read-only ones.
+    template <class U, class = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+    BasicMatrixView(const BasicMatrixView<U>& other)
+        : BasicMatrixView(other.rawData(), other.shape().first, other.shape().second, other.stride()) {}
+
+    BasicMatrixView& operator=(const BasicMatrixView& source) {
+        return assign(source);
+    }
+
+    BasicMatrixView& operator=(const Matrix& source) {
+        return assign(expr::borrow(source));
+    }
+
+    template <class E, class = expr::EnableIfNode<E>>
+    BasicMatrixView& operator=(const E& source) {
+        return assign(source);
+    }
+
+    template <class E, class = expr::EnableIfOperand<E>>
+    BasicMatrixView& operator+=(const E& source) {
+        update(expr::borrow(source), [](const double* values, double* target, size_t n) {
+            simd::add(target, values, target, n);
+        });
+        return *this;
+    }
+
+    template <class E, class = expr::EnableIfOperand<E>>
+    BasicMatrixView& operator-=(const E& source) {
+        update(expr::borrow(source), [](const double* values, double* target, size_t n) {
+            simd::sub(target, values, target, n);
+        });
+        return *this;
+    }
+
+    BasicMatrixView& operator*=(const double& number) {
+        for (size_t i = 0; i < dim_size.first; ++i) {
+            simd::scale(rowData(i), number, rowData(i), dim_size.second);
+        }
+        return *this;
+    }
+
+    void fill(const double& value) {
+        for (size_t i = 0; i < dim_size.first; ++i) {
+            std::fill_n(rowData(i), dim_size.second, value);
+        }
+    }
+
+    T& operator()(size_t row, size_t col) const {
+        return data[row * row_stride + col];
+    }
+
+    T& get(size_t row, size_t col) const {
+        if (row >= dim_size.first || col >= dim_size.second) {
+            throw OutOfBoundsException();
+        }
+        return (*this)(row, col);
+    }
+
+    BasicRowView<T> row(size_t row) const {
+        if (row >= dim_size.first) {
+            throw OutOfBoundsException();
+        }
+        return BasicRowView<T>(rowData(row), dim_size.second);
+    }
+
+    BasicColumnView<T> column(size_t col) const {
+        if (col >= dim_size.second) {
+            throw OutOfBoundsException();
+        }
+        return BasicColumnView<T>(data + col, dim_size.first, row_stride);
+    }
+
+    BasicMatrixView block(size_t row, size_t col, size_t rows, size_t cols) const {
+        if (row + rows > dim_size.first || col + cols > dim_size.second) {
+            throw OutOfBoundsException();
+        }
+        return BasicMatrixView(data + row * row_stride + col, rows, cols, row_stride);
+    }
+
+    std::pair<size_t, size_t> shape() const {
+        return dim_size;
+    }
+
+    size_t stride() const {
+        return row_stride;
+    }
+
+    T* rawData() const {
+        return data;
+    }
+
+    const double* tile(size_t row, size_t col, size_t, double*) const {
+        return data + row * row_stride + col;
+    }
+
+    bool reads(const double* begin, const double* end) const {
+        return dim_size.first != 0 && dim_size.second != 0 && data < end && begin < extentEnd();
+    }
+
+    bool contiguous() const {
+        return dim_size.first <= 1 || row_stride == dim_size.second;
+    }
+
+protected:
+    T* rowData(size_t row) const {
+        return data + row * row_stride;
+    }
+
+    // One past the last element the view covers.
+    T* extentEnd() const {
+        return data + (dim_size.first - 1) * row_stride + dim_size.second;
+    }
+
+    template <class E>
+    BasicMatrixView& assign(const E& source) {
+        update(source, [](const double* values, double* target, size_t n) {
+            if (values != target) {
+                std::copy_n(values, n, target);
+            }
+        });
+        return *this;
+    }
+
+    // Calls kernel(values, target, n) for every tile of `source` and the
+    // matching elements of the view. A source overlapping the view may be
+    // shifted against it, so it is evaluated into a temporary first.
+    template <class E, class Kernel>
+    void update(const E& source, Kernel kernel) {
+        if (source.shape() != dim_size) {
+            throw SizeMismatchException();
+        }
+        if (dim_size.first == 0 || dim_size.second == 0) {
+            return;
+        }
+
+        if (source.reads(data, extentEnd())) {
+            Matrix copy(dim_size.first, dim_size.second);
+            expr::evaluate(copy, source);
+            update(expr::borrow(copy), kernel);
+            return;
+        }
+
+        double scratch[expr::kTile];
+        for (size_t row = 0; row < dim_size.first; ++row) {
+            for (size_t col = 0; col < dim_size.second; col += expr::kTile) {
+                size_t n = std::min(expr::kTile, dim_size.second - col);
+                kernel(source.tile(row, col, n, scratch), rowData(row) + col, n);
+            }
+        }
+    }
+
+    T* data;
+    std::pair<size_t, size_t> dim_size;
+    size_t row_stride;
+};
+
+// Random-access iterator over every `step`-th element.
+template <class T>
+class StridedIterator {
+public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_const_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    StridedIterator() : current(nullptr), step(1) {}
+    StridedIterator(T* current, size_t step) : current(current), step(static_cast<difference_type>(step)) {}
+
+    reference operator*() const { return *current; }
+    pointer operator->() const { return current; }
+    reference operator[](difference_type n) const { return current[n * step]; }
+
+    StridedIterator& operator++() { current += step; return *this; }
+    StridedIterator& operator--() { current -= step; return *this; }
+    StridedIterator operator++(int) { StridedIterator old = *this; ++*this; return old; }
+    StridedIterator operator--(int) { StridedIterator old = *this; --*this; return old; }
+
+    StridedIterator& operator+=(difference_type n) { current += n * step; return *this; }
+    StridedIterator& operator-=(difference_type n) { current -= n * step; return *this; }
+    StridedIterator operator+(difference_type n) const { return StridedIterator(*this) += n; }
+    StridedIterator operator-(difference_type n) const { return StridedIterator(*this) -= n; }
+    friend StridedIterator operator+(difference_type n, const StridedIterator& it) { return it + n; }
+
+    difference_type operator-(const StridedIterator& other) const { return (current - other.current) / step; }
+
+    bool operator==(const StridedIterator& other) const { return current == other.current; }
+    bool operator!=(const StridedIterator& other) const { return current != other.current; }
+    bool operator<(const StridedIterator& other) const { return current < other.current; }
+    bool operator>(const StridedIterator& other) const { return current > other.current; }
+    bool operator<=(const StridedIterator& other) const { return current <= other.current; }
+    bool operator>=(const StridedIterator& other) const { return current >= other.current; }
+
+private:
+    T* current;
+    difference_type step;
+};
+
+// A single row: a 1 x n view that is also a contiguous range of n elements.
+template <class T>
+class BasicRowView : public BasicMatrixView<T> {
+public:
+    using iterator = T*;
+
+    BasicRowView(T* data, size_t size) : BasicMatrixView<T>(data, 1, size, size) {}
+    // Copies the view, not the elements; declared since operator= below is.
+    BasicRowView(const BasicRowView&) = default;
+
+    template <class U, class = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+    BasicRowView(const BasicRowView<U>& other) : BasicRowView(other.rawData(), other.size()) {}
+
+    using BasicMatrixView<T>::operator=;
+
+    BasicRowView& operator=(const BasicRowView& source) {
+        this->assign(source);
+        return *this;
+    }
+
+    T& operator[](size_t col) const {
+        return this->data[col];
+    }
+
+    size_t size() const {
+        return this->dim_size.second;
+    }
+
+    iterator begin() const {
+        return this->data;
+    }
+
+    iterator end() const {
+        return this->data + size();
+    }
+
+    std::vector<double> toVector() const {
+        return std::vector<double>(begin(), end());
+    }
+};
+
+// A single column: an n x 1 view walked with the row stride of its matrix.
+template <class T>
+class BasicColumnView : public BasicMatrixView<T> {
+public:
+    using iterator = StridedIterator<T>;
+
+    BasicColumnView(T* data, size_t size, size_t stride) : BasicMatrixView<T>(data, size, 1, stride) {}
+    // Copies the view, not the elements; declared since operator= below is.
+    BasicColumnView(const BasicColumnView&) = default;
+
+    template <class U, class = std::enable_if_t<std::is_convertible<U*, T*>::value>>
+    BasicColumnView(const BasicColumnView<U>& other)
+        : BasicColumnView(other.rawData(), other.size(), other.stride()) {}
+
+    using BasicMatrixView<T>::operator=;
+
+    BasicColumnView& operator=(const BasicColumnView& source) {
+        this->assign(source);
+        return *this;
+    }
+
+    T& operator[](size_t row) const {
+        return this->data[row * this->row_stride];
+    }
+
+    size_t size() const {
+        return this->dim_size.first;
+    }
+
+    iterator begin() const {
+        return iterator(this->data, this->row_stride);
+    }
+
+    iterator end() const {
+        return begin() + static_cast<std::ptrdiff_t>(size());
+    }
+
+    std::vector<double> toVector() const {
+        return std::vector<double>(begin(), end());
+    }
+};
+
+}  // namespace task
@@ -4,7 +4,22 @@
 #include <algorithm>
 #include <sstream>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory_resource>
 #include "src/matrix.h"
+#include "src/basic_matrix.h"
+#include "src/batch.h"
+#include "src/fixed_matrix.h"
+#include "src/lu.h"
+#include "src/resource.h"
+#include "src/serialization.h"
+#include "src/solvers.h"
+#include "src/sparse.h"
+#include "src/gemm.h"
+#include "src/simd.h"
+#include "src/thread_pool.h"
+#include "../../chuck_allocator/chunk_allocator.h"
 
 
 using task::Matrix;
@@ -68,6 +83,33 @@ void FailWithMsg(const std::string& msg, int line) {
 const double EPS = 1e-6;
 
 
+// Counts what passes through to new_delete_resource().
+class CountingResource : public std::pmr::memory_resource {
+public:
+    size_t allocations = 0;
+    size_t live = 0;
+    bool aligned = true;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        aligned = aligned && reinterpret_cast<uintptr_t>(ptr) % Matrix::kAlignment == 0;
+        ++allocations;
+        ++live;
+        return ptr;
+    }
+
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+        --live;
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+
 int main(int argc, char** argv) {
 
     {
@@ -118,6 +160,15 @@ int main(int argc, char** argv) {
 
         ASSERT_TRUE_MSG(mat[0][0] == 1. && mat[0][1] == 0. && mat[1][0] == 0. && mat[1][1] == 0., "resize()")
 
+        auto row = mat2[0];
+        mat2[0][0] = -1.;
+        mat2.resize(1, 1);
+        ASSERT_TRUE_MSG(row.size() == 2 && row[0] != -1. && row[1] == 100., "Row copies own their elements")
+
+        ASSERT_EXCEPTION_MSG(Matrix(size_t(1) << 61, 1), std::bad_array_new_length, "Matrix size overflow")
+        ASSERT_EXCEPTION_MSG(Matrix(1, size_t(-1) - 3), std::bad_array_new_length, "Matrix size overflow")
+        ASSERT_EXCEPTION_MSG(Matrix(size_t(1) << 40, size_t(1) << 40), std::bad_array_new_length, "Matrix size overflow")
+
         /*
         REPEAT(1000) {
             // oh boy i sure can't wait to resize
@@ -139,6 +190,800 @@ int main(int argc, char** argv) {
 
     }
 
+    {
+        auto mat1 = RandomMatrix(30, 40);
+        auto mat2 = mat1;
+
+        Matrix moved(std::move(mat2));
+        ASSERT_TRUE_MSG(moved == mat1, "Move constructor")
+
+        mat2 = std::move(moved);
+        ASSERT_TRUE_MSG(mat2 == mat1, "Move assignment")
+
+        moved = mat1;
+        ASSERT_TRUE_MSG(moved == mat1, "Assignment to moved-from matrix")
+
+        auto mat3 = RandomMatrix(30, 40);
+        Matrix expected = mat1;
+        expected *= 2.;
+        expected += mat3;
+        expected -= mat1;
+
+        ASSERT_TRUE_MSG((mat1 * 2. + mat3 - mat1) == expected, "Chained rvalue arithmetic")
+        ASSERT_TRUE_MSG(-(mat1 * 2.) == -expected + mat3 - mat1, "Unary - on rvalue")
+    }
+
+    REPEAT(10)
+    {
+        auto mat1 = RandomMatrix(RandomUInt(1, 150), RandomUInt(200, 600));
+        auto mat2 = RandomMatrix(mat1.size().second, RandomUInt(1, 150));
+
+        task::setGemmKernel(task::GemmKernel::kNaive);
+        auto expected = mat1 * mat2;
+        task::setGemmKernel(task::GemmKernel::kBlocked);
+        auto blocked = mat1 * mat2;
+        task::setGemmKernel(task::GemmKernel::kAuto);
+
+        ASSERT_TRUE_MSG(blocked == expected, "Blocked matrix multiplication")
+    }
+
+    REPEAT(10)
+    {
+        auto mat1 = RandomMatrix(RandomUInt(1, 200), RandomUInt(1, 200));
+        auto mat2 = RandomMatrix(mat1.size().second, RandomUInt(1, 200));
+        auto[m, k] = mat1.size();
+        size_t n = mat2.size().second;
+
+        task::setGemmKernel(task::GemmKernel::kNaive);
+        auto expected = mat1 * mat2;
+        task::setGemmKernel(task::GemmKernel::kAuto);
+
+        // Classic products are accurate to about k * u * max|A| * max|B|;
+        // every Strassen level multiplies the bound by a constant, at most 4 here.
+        Matrix result(m, n);
+        size_t cutoff = RandomUInt(1, 16);
+        task::gemm::strassen(m, n, k, mat1.rawData(), mat1.stride(), mat2.rawData(), mat2.stride(),
+                             result.rawData(), result.stride(), cutoff);
+
+        size_t levels = 0;
+        for (size_t size = std::min({ m, n, k }); size > cutoff; size /= 2) {
+            ++levels;
+        }
+        double bound = 10. * k * 1.1e-16 * 10. * 10. * std::pow(4., levels);
+        double error = 0.;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t j = 0; j < n; ++j) {
+                error = std::max(error, fabs(result[i][j] - expected[i][j]));
+            }
+        }
+        ASSERT_TRUE_MSG(error <= bound, "Strassen multiplication error bound")
+    }
+
+    {
+        auto mat1 = RandomMatrix(RandomUInt(257, 300), RandomUInt(257, 300));
+        auto mat2 = RandomMatrix(mat1.size().second, RandomUInt(257, 300));
+
+        task::setGemmKernel(task::GemmKernel::kStrassen);
+        auto strassen = mat1 * mat2;
+        task::setGemmKernel(task::GemmKernel::kAuto);
+
+        ASSERT_TRUE_MSG(strassen == mat1 * mat2, "Strassen matrix multiplication")
+    }
+
+    REPEAT(10)
+    {
+        auto mat = RandomMatrix(RandomUInt(1, 300), RandomUInt(1, 300));
+        auto[m, n] = mat.size();
+        auto x = RandomMatrix(n, 1);
+        auto y = RandomMatrix(m, 1);
+
+        auto product = mat * x.getColumn(0);
+        auto expected = mat * x;
+        bool equal = product.size() == m;
+        for (size_t i = 0; equal && i < m; ++i) {
+            equal = fabs(product[i] - expected[i][0]) < EPS;
+        }
+        ASSERT_TRUE_MSG(equal, "Matrix-vector product")
+
+        auto transposed = mat.multiplyTransposed(y.getColumn(0));
+        expected = mat.transposed() * y;
+        equal = transposed.size() == n;
+        for (size_t j = 0; equal && j < n; ++j) {
+            equal = fabs(transposed[j] - expected[j][0]) < EPS;
+        }
+        ASSERT_TRUE_MSG(equal, "Transposed matrix-vector product")
+
+        double alpha = RandomDouble();
+        Matrix updated = mat;
+        updated.rankOneUpdate(alpha, y.getColumn(0), x.getColumn(0));
+        ASSERT_TRUE_MSG(updated == mat + alpha * (y * x.transposed()), "Rank-1 update")
+
+        ASSERT_EXCEPTION_MSG(mat * std::vector<double>(n + 1), task::SizeMismatchException, "Matrix-vector size mismatch")
+        ASSERT_EXCEPTION_MSG(mat.multiplyTransposed(std::vector<double>(m + 1)), task::SizeMismatchException,
+                             "Transposed matrix-vector size mismatch")
+        ASSERT_EXCEPTION_MSG(updated.rankOneUpdate(1., std::vector<double>(m + 1), x.getColumn(0)), task::SizeMismatchException,
+                             "Rank-1 update size mismatch")
+    }
+
+    {
+        auto mat1 = RandomMatrix(RandomUInt(1, 50), RandomUInt(1, 300));
+        auto mat2 = RandomMatrix(mat1.size().first, mat1.size().second);
+        auto mat3 = RandomMatrix(mat1.size().second, RandomUInt(1, 50));
+
+        Matrix expected = mat1;
+        expected *= 2.;
+        expected += mat2;
+        expected -= mat1;
+
+        Matrix fused = mat1 * 2. + mat2 - mat1;
+        ASSERT_TRUE_MSG(fused == expected, "Fused expression")
+
+        auto lazy = 2. * Matrix(3, 3) - Matrix(3, 3);
+        ASSERT_TRUE_MSG(Matrix(lazy) == Matrix(3, 3), "Expression owns temporaries")
+
+        Matrix aliased = mat1;
+        aliased = aliased * 2. + aliased * 3.;
+        ASSERT_TRUE_MSG(aliased == mat1 * 5., "Expression aliasing its target")
+
+        aliased = mat1;
+        aliased += -mat2 + mat1;
+        ASSERT_TRUE_MSG(aliased == mat1 * 2. - mat2, "Compound assignment of an expression")
+
+        aliased -= aliased * 3.;
+        ASSERT_TRUE_MSG(aliased == (mat2 - mat1 * 2.) * 2., "Compound assignment reading its target")
+        ASSERT_EXCEPTION_MSG(aliased += mat3 * 2., task::SizeMismatchException, "Compound assignment size mismatch")
+
+        Matrix product = (mat1 + mat2) * mat3;
+        Matrix sum = mat1 + mat2;
+        ASSERT_TRUE_MSG(product == sum * mat3, "Product of an expression")
+
+        ASSERT_EXCEPTION_MSG(mat1 + mat2 - mat3, task::SizeMismatchException, "Expression size mismatch")
+    }
+
+    for (auto shape : {std::make_pair(1, 1), std::make_pair(100, 100), std::make_pair(37, 37),
+                       std::make_pair(300, 7), std::make_pair(7, 300), std::make_pair(1, 50),
+                       std::make_pair(70, 130), std::make_pair(130, 70)}) {
+        auto mat = RandomMatrix(shape.first, shape.second);
+
+        auto expected = Matrix(shape.second, shape.first);
+        for (size_t i = 0; i < mat.size().first; ++i) {
+            for (size_t j = 0; j < mat.size().second; ++j) {
+                expected[j][i] = mat[i][j];
+            }
+        }
+
+        ASSERT_TRUE_MSG(mat.transposed() == expected, "Tiled transposed()")
+
+        auto copy = mat;
+        copy.transpose();
+        ASSERT_TRUE_MSG(copy == expected, "In-place transpose()")
+        copy.transpose();
+        ASSERT_TRUE_MSG(copy == mat, "In-place transpose() twice")
+        copy.transpose();
+        ASSERT_TRUE_MSG(copy == expected, "In-place transpose() three times")
+    }
+
+    for (size_t n : {1, 7, 64, 150}) {
+        auto mat = RandomMatrix(n, n);
+        auto rhs = RandomMatrix(n, RandomUInt(1, 5));
+        task::LU lu(mat);
+
+        ASSERT_TRUE_MSG(fabs(lu.det() - mat.det()) <= fabs(mat.det()) * 1e-9, "LU det()")
+        ASSERT_TRUE_MSG(mat * lu.solve(rhs) == rhs, "LU solve()")
+        ASSERT_TRUE_MSG(mat * lu.inverse() == Matrix(n, n), "LU inverse()")
+
+        auto column = rhs.getColumn(0);
+        auto solution = lu.solve(column);
+        for (size_t i = 0; i < n; ++i) {
+            double value = 0.;
+            for (size_t j = 0; j < n; ++j) {
+                value += mat[i][j] * solution[j];
+            }
+            ASSERT_TRUE_MSG(fabs(value - column[i]) < EPS, "LU solve() for a vector")
+        }
+
+        ASSERT_EXCEPTION_MSG(lu.solve(RandomMatrix(n + 1, 1)), task::SizeMismatchException, "LU solve()")
+    }
+
+    for (size_t n : {1, 5, 40, 130}) {
+        auto mat = RandomMatrix(n, n);
+        double reference = static_cast<double>(task::matrixCast<long double>(mat).det());
+        task::Determinant determinant = mat.determinant();
+
+        ASSERT_TRUE_MSG(fabs(mat.det() - reference) <= fabs(reference) * 1e-9, "det() by forward elimination")
+        ASSERT_TRUE_MSG(determinant.value() == mat.det() && determinant.sign() == (reference > 0 ? 1 : -1), "determinant()")
+        ASSERT_TRUE_MSG(fabs(determinant.logAbs() - log(fabs(reference))) < 1e-9 * n, "determinant() logAbs()")
+
+        // det(c * A) = c^n det(A) leaves the range of double for large n.
+        for (double scale : {1e4, 1e-2}) {
+            Matrix scaled_mat = mat * scale;
+            task::Determinant scaled = scaled_mat.determinant();
+            double expected = determinant.logAbs() + n * log(scale);
+
+            ASSERT_TRUE_MSG(fabs(scaled.logAbs() - expected) < 1e-9 * n * 10, "determinant() out of range")
+            ASSERT_TRUE_MSG(scaled.sign() == determinant.sign() && scaled_mat.det() == scaled.value(), "determinant() out of range")
+        }
+        if (n == 130) {
+            ASSERT_TRUE_MSG(std::isinf(Matrix(mat * 1e4).det()), "det() out of range")
+        }
+    }
+
+    {
+        // 10^1500 after the first half of the pivots.
+        Matrix diagonal(600, 600);
+        for (size_t i = 0; i < 600; ++i) {
+            diagonal[i][i] = i < 300 ? 1e5 : -1e-5;
+        }
+        ASSERT_TRUE_MSG(fabs(diagonal.det() - 1.) < 1e-9, "det() without intermediate overflow")
+        ASSERT_TRUE_MSG(diagonal.determinant().sign() == 1 && fabs(diagonal.determinant().logAbs()) < 1e-9, "determinant()")
+
+        diagonal[599][599] = 0.;
+        ASSERT_TRUE_MSG(diagonal.determinant().sign() == 0 && diagonal.det() == 0., "determinant() of a singular matrix")
+
+        // Every pivot is below EPS, yet the matrix is far from singular.
+        Matrix spd(300, 300);
+        double previous = 1., current = 4.;
+        for (size_t i = 0; i < 300; ++i) {
+            spd[i][i] = 4e-7;
+            if (i > 0) {
+                spd[i][i - 1] = spd[i - 1][i] = -1e-7;
+                std::swap(previous, current);
+                current = 4. * previous - current;
+            }
+        }
+        task::Determinant small = spd.determinant();
+        ASSERT_TRUE_MSG(small.sign() == 1 && fabs(small.logAbs() - (log(current) + 300 * log(1e-7))) < 1e-9 * 300, "determinant() of a small-scale matrix")
+        ASSERT_TRUE_MSG(spd.det() == 0., "det() of a small-scale matrix")
+        ASSERT_EXCEPTION_MSG(Matrix(3, 4).determinant(), task::SizeMismatchException, "determinant() of a non-square matrix")
+    }
+
+    {
+        auto singular = RandomMatrix(5, 5);
+        for (size_t j = 0; j < 5; ++j) {
+            singular[4][j] = singular[0][j] + singular[1][j];
+        }
+
+        task::LU lu(singular);
+        ASSERT_TRUE_MSG(lu.isSingular() && lu.det() == 0., "LU of a singular matrix")
+        ASSERT_EXCEPTION_MSG(lu.inverse(), task::SingularMatrixException, "LU of a singular matrix")
+        ASSERT_EXCEPTION_MSG(task::LU(RandomMatrix(2, 3)), task::SizeMismatchException, "LU of a non-square matrix")
+    }
+
+    REPEAT(5)
+    {
+        size_t n = RandomUInt(1, 150);
+        auto mat = RandomMatrix(n, n);
+        Matrix spd = mat * mat.transposed();
+        Matrix nonsymmetric = mat;
+        for (size_t i = 0; i < n; ++i) {
+            spd[i][i] += n;
+            nonsymmetric[i][i] += 10. * n;
+        }
+        auto b = RandomMatrix(n, 1).getColumn(0);
+
+        task::SolverOptions options;
+        task::JacobiPreconditioner jacobi(spd);
+        task::IncompleteCholeskyPreconditioner cholesky(spd);
+
+        auto plain = task::conjugateGradient(spd, b, options);
+        auto scaled = task::conjugateGradient(spd, b, options, &jacobi);
+        auto factored = task::conjugateGradient(spd, b, options, &cholesky);
+        ASSERT_TRUE_MSG(plain.converged && plain.residual < 1e-8 && plain.history.size() == plain.iterations,
+                        "Conjugate gradient")
+        ASSERT_TRUE_MSG(scaled.converged && scaled.residual < 1e-8, "Conjugate gradient with Jacobi")
+        // Without zero elements incomplete Cholesky is the full factorization.
+        ASSERT_TRUE_MSG(factored.converged && factored.residual < 1e-8 && factored.iterations <= 2,
+                        "Conjugate gradient with incomplete Cholesky")
+
+        options.restart = RandomUInt(1, 20);
+        task::JacobiPreconditioner diagonal(nonsymmetric);
+        auto krylov = task::gmres(nonsymmetric, b, options);
+        auto preconditioned = task::gmres(nonsymmetric, b, options, &diagonal);
+        ASSERT_TRUE_MSG(krylov.converged && krylov.residual < 1e-8, "GMRES")
+        ASSERT_TRUE_MSG(preconditioned.converged && preconditioned.residual < 1e-8, "GMRES with Jacobi")
+
+        auto lu = task::LU(nonsymmetric).solve(b);
+        double error = 0.;
+        for (size_t i = 0; i < n; ++i) {
+            error = std::max(error, fabs(krylov.x[i] - lu[i]));
+        }
+        ASSERT_TRUE_MSG(error < 1e-8, "GMRES solution")
+    }
+
+    {
+        // Five-point Laplacian on a 30 x 30 grid.
+        const size_t side = 30, n = side * side;
+        std::vector<task::SparseMatrix::Triplet> triplets;
+        for (size_t i = 0; i < n; ++i) {
+            triplets.push_back({ i, i, 4. });
+            if (i % side != 0) {
+                triplets.push_back({ i, i - 1, -1. });
+                triplets.push_back({ i - 1, i, -1. });
+            }
+            if (i >= side) {
+                triplets.push_back({ i, i - side, -1. });
+                triplets.push_back({ i - side, i, -1. });
+            }
+        }
+        auto laplacian = task::SparseMatrix::fromTriplets(n, n, triplets);
+        task::SparseOperator op(laplacian);
+        std::vector<double> b(n, 1.);
+
+        task::SolverOptions options;
+        task::IncompleteCholeskyPreconditioner cholesky(laplacian);
+        auto plain = task::conjugateGradient(op, b, options);
+        auto preconditioned = task::conjugateGradient(op, b, options, &cholesky);
+        ASSERT_TRUE_MSG(plain.converged && preconditioned.converged && preconditioned.residual < 1e-8 &&
+                        preconditioned.iterations < plain.iterations, "Sparse conjugate gradient")
+
+        options.restart = 20;
+        auto krylov = task::gmres(op, b, options, &cholesky);
+        ASSERT_TRUE_MSG(krylov.converged && krylov.residual < 1e-8, "Sparse GMRES")
+
+        size_t calls = 0;
+        options.monitor = [&](const task::IterationStats& stats) {
+            ++calls;
+            return stats.iteration < 3;
+        };
+        auto stopped = task::conjugateGradient(op, b, options);
+        ASSERT_TRUE_MSG(!stopped.converged && stopped.iterations == 3 && calls == 3 &&
+                        stopped.history.size() == 3, "Solver monitor")
+
+        options.monitor = nullptr;
+        options.max_iterations = 5;
+        options.initial_guess = preconditioned.x;
+        auto warm = task::gmres(op, b, options);
+        ASSERT_TRUE_MSG(warm.converged && warm.iterations <= 1, "Solver initial guess")
+
+        ASSERT_EXCEPTION_MSG(task::conjugateGradient(op, std::vector<double>(n + 1)), task::SizeMismatchException,
+                             "Solver size mismatch")
+        ASSERT_EXCEPTION_MSG(task::IncompleteCholeskyPreconditioner(-laplacian), task::SingularMatrixException,
+                             "Incomplete Cholesky of a negative definite matrix")
+        ASSERT_EXCEPTION_MSG(task::JacobiPreconditioner(task::SparseMatrix(3, 3)), task::SingularMatrixException,
+                             "Jacobi with a zero diagonal")
+        ASSERT_EXCEPTION_MSG(task::MatrixOperator(RandomMatrix(2, 3)), task::SizeMismatchException,
+                             "Operator of a non-square matrix")
+    }
+
+    {
+        auto mat = RandomMatrix(70, 90);
+        const Matrix& constant = mat;
+
+        auto column = constant.column(5);
+        auto expected_column = mat.getColumn(5);
+        ASSERT_TRUE_MSG(std::equal(column.begin(), column.end(), expected_column.begin(), expected_column.end()), "Column view")
+        ASSERT_TRUE_MSG(column.rawData() == &mat[0][5], "Column view does not copy")
+
+        auto row = mat.row(3);
+        auto expected_row = mat.getRow(3);
+        ASSERT_TRUE_MSG(std::equal(row.begin(), row.end(), expected_row.begin(), expected_row.end()), "Row view")
+
+        Matrix sum = mat.row(1) + mat.row(2) * 2.;
+        for (size_t j = 0; j < 90; ++j) {
+            ASSERT_TRUE_MSG(fabs(sum[0][j] - (mat[1][j] + mat[2][j] * 2.)) < EPS, "Arithmetic on row views")
+        }
+
+        auto block = mat.block(10, 20, 30, 40);
+        Matrix copy = block;
+        for (size_t i = 0; i < 30; ++i) {
+            for (size_t j = 0; j < 40; ++j) {
+                ASSERT_TRUE_MSG(copy[i][j] == mat[10 + i][20 + j], "Sub-matrix view")
+            }
+        }
+        ASSERT_TRUE_MSG(block == copy && block.column(3) == copy.column(3), "Comparing views")
+
+        Matrix before = mat;
+        mat.column(0) -= mat.column(1) * 2.;
+        mat.block(0, 1, 69, 1) = mat.block(1, 1, 69, 1);
+        for (size_t i = 0; i < 70; ++i) {
+            ASSERT_TRUE_MSG(fabs(mat[i][0] - (before[i][0] - before[i][1] * 2.)) < EPS, "Assigning through a column view")
+            ASSERT_TRUE_MSG(mat[i][1] == before[i < 69 ? i + 1 : i][1], "Assigning overlapping views")
+        }
+
+        mat.block(0, 0, 2, 2) = Matrix(2, 2);
+        ASSERT_TRUE_MSG(mat[0][0] == 1. && mat[0][1] == 0. && mat[1][0] == 0. && mat[1][1] == 1., "Assigning a matrix to a view")
+        ASSERT_EXCEPTION_MSG(mat.block(0, 0, 2, 3) = Matrix(2, 2), task::SizeMismatchException, "Assigning to a view")
+        ASSERT_EXCEPTION_MSG(mat.block(60, 0, 11, 1), task::OutOfBoundsException, "Sub-matrix view")
+        ASSERT_EXCEPTION_MSG(mat.column(90), task::OutOfBoundsException, "Column view")
+    }
+
+    for (size_t cols : {1, 64, 70}) {
+        auto mat = RandomMatrix(RandomUInt(1, 50), cols);
+
+        std::stringstream stream;
+        task::writeBinary(stream, mat);
+        ASSERT_TRUE_MSG(task::readBinary(stream) == mat, "Binary round trip")
+
+        std::string bytes = stream.str();
+        bytes[bytes.size() - 1] ^= 1;
+        std::stringstream corrupted(bytes);
+        ASSERT_EXCEPTION_MSG(task::readBinary(corrupted), task::MatrixFormatException, "Binary checksum")
+
+        std::stringstream truncated(bytes.substr(0, bytes.size() / 2));
+        ASSERT_EXCEPTION_MSG(task::readBinary(truncated), task::MatrixFormatException, "Truncated binary input")
+
+        task::MatrixFileHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        header.rows = header.cols = uint64_t(1) << 30;
+        std::memcpy(&bytes[0], &header, sizeof(header));
+        std::stringstream oversized(bytes);
+        ASSERT_EXCEPTION_MSG(task::readBinary(oversized), task::MatrixFormatException, "Binary header larger than input")
+
+        const std::string path = "matrix_test.bin";
+        task::saveBinary(path, mat);
+        {
+            task::MappedMatrix mapped(path);
+            ASSERT_TRUE_MSG(mapped.size() == mat.size() && mapped.verify(), "Memory-mapped matrix")
+            ASSERT_TRUE_MSG(mapped.view() == mat && mapped.column(0) == mat.column(0), "Memory-mapped matrix")
+            ASSERT_TRUE_MSG(task::loadBinary(path) == mat, "Binary file round trip")
+        }
+        std::remove(path.c_str());
+    }
+
+    {
+        auto mat = RandomMatrix(400, 300);
+        mat[0][0] = 1e-300;
+        mat[0][1] = -0.1;
+
+        std::stringstream stream;
+        stream << "400 300\n" << mat;
+        std::string text = stream.str();
+
+        Matrix parsed;
+        stream >> parsed;
+        bool exact = parsed.size() == mat.size();
+        for (size_t i = 0; exact && i < 400; ++i) {
+            exact = std::equal(mat.row(i).begin(), mat.row(i).end(), parsed.row(i).begin());
+        }
+        ASSERT_TRUE_MSG(exact, "Text round trip is exact")
+
+        for (auto policy : {task::ExecutionPolicy::kSequential, task::ExecutionPolicy::kParallel}) {
+            Matrix bulk = task::parseText(text.data(), text.data() + text.size(), policy);
+            ASSERT_TRUE_MSG(bulk == mat && bulk[0][0] == 1e-300, "Bulk text parser")
+        }
+
+        for (std::string bad : {"2 2 1 2 3", "2 2 1 2 3 4 5", "1 2 1 x", "-1 2", "1000000000 1000000000 1"}) {
+            ASSERT_EXCEPTION_MSG(task::parseText(bad.data(), bad.data() + bad.size()), task::MatrixFormatException, "Malformed text")
+        }
+
+        std::stringstream two("1 2 +1 -2.5e1\n2 1 3\n4");
+        Matrix first, second;
+        two >> first >> second;
+        ASSERT_TRUE_MSG(two && first[0][1] == -25. && second.size().first == 2 && second[1][0] == 4., "Reading consecutive matrices")
+
+        Matrix untouched = mat;
+        std::stringstream bad("2 2 1 2 x 4");
+        bad >> untouched;
+        ASSERT_TRUE_MSG(bad.fail() && untouched == mat, "Malformed stream input")
+
+        for (std::string huge : {"2305843009213693952 1 1.0", "1000000000 1000000000 1"}) {
+            std::stringstream oversized(huge);
+            oversized >> untouched;
+            ASSERT_TRUE_MSG(oversized.fail() && untouched == mat, "Stream input larger than the stream")
+        }
+    }
+
+    {
+        constexpr task::Matrix2 rotation{{0., -1.}, {1., 0.}};
+        constexpr task::Matrix2 squared = rotation * rotation;
+        static_assert(squared[0][0] == -1. && squared[1][1] == -1. && squared[0][1] == 0., "constexpr product");
+        static_assert(rotation.det() == 1. && (rotation * rotation.inverse()) == task::Matrix2(), "constexpr inverse");
+
+        auto check = [](auto fixed) {
+            constexpr size_t n = decltype(fixed)::kRows;
+            auto dynamic = RandomMatrix(n, n);
+            fixed = decltype(fixed)(dynamic);
+
+            ASSERT_TRUE_MSG(fabs(fixed.det() - dynamic.det()) <= fabs(dynamic.det()) * 1e-9 + EPS, "FixedMatrix det()")
+            ASSERT_TRUE_MSG((fixed * fixed.inverse()).toMatrix() == Matrix(n, n), "FixedMatrix inverse()")
+            ASSERT_TRUE_MSG((fixed * fixed).toMatrix() == dynamic * dynamic, "FixedMatrix product")
+            ASSERT_TRUE_MSG((fixed * 2. - fixed).toMatrix() == dynamic, "FixedMatrix arithmetic")
+            ASSERT_TRUE_MSG(fixed.transposed().toMatrix() == dynamic.transposed(), "FixedMatrix transposed()")
+        };
+        check(task::FixedMatrix<1, 1>());
+        check(task::Matrix2());
+        check(task::Matrix3());
+        check(task::Matrix4());
+        check(task::FixedMatrix<7, 7>());
+        check(task::FixedMatrix<9, 9>());
+
+        auto wide = RandomMatrix(3, 5);
+        task::FixedMatrix<3, 5> fixed_wide(wide);
+        task::FixedMatrix<5, 2> tall(wide.transposed().block(0, 0, 5, 2));
+        ASSERT_TRUE_MSG((fixed_wide * tall).toMatrix() == wide * wide.transposed().block(0, 0, 5, 2), "Rectangular FixedMatrix product")
+
+        ASSERT_EXCEPTION_MSG(task::Matrix3(wide), task::SizeMismatchException, "FixedMatrix from Matrix")
+        ASSERT_EXCEPTION_MSG(task::Matrix2({{1., 2.}, {2., 4.}}).inverse(), task::SingularMatrixException, "FixedMatrix inverse()")
+        using Matrix5 = task::FixedMatrix<5, 5>;
+        ASSERT_EXCEPTION_MSG(Matrix5::zero().inverse(), task::SingularMatrixException, "FixedMatrix inverse()")
+
+        // Singularity does not depend on scale.
+        task::Matrix4 scale = task::Matrix4() * 0.03;
+        ASSERT_TRUE_MSG(scale * scale.inverse() == task::Matrix4(), "Small-scale FixedMatrix inverse()")
+        Matrix5 small = Matrix5() * 1e-4;
+        ASSERT_TRUE_MSG(small.det() > 0. && small * small.inverse() == Matrix5(), "Small-scale FixedMatrix inverse()")
+        ASSERT_EXCEPTION_MSG((task::Matrix2({{1., 2.}, {2., 4.}}) * 1e8).inverse(), task::SingularMatrixException, "FixedMatrix inverse()")
+
+        // det() and inverse() agree on a determinant left by rounding alone.
+        task::Matrix3 rounded{{.1, .2, .3}, {.4, .5, .6}, {.7, .8, .9}};
+        ASSERT_TRUE_MSG(rounded.det() == 0., "FixedMatrix det() of a singular matrix")
+        ASSERT_EXCEPTION_MSG(rounded.inverse(), task::SingularMatrixException, "FixedMatrix inverse()")
+        ASSERT_EXCEPTION_MSG(task::Matrix2().get(2, 0), task::OutOfBoundsException, "FixedMatrix get()")
+    }
+
+    {
+        auto dynamic = RandomMatrix(RandomUInt(1, 30), RandomUInt(1, 70));
+        auto other = RandomMatrix(dynamic.size().second, RandomUInt(1, 40));
+        Matrix product = dynamic * other;
+
+        auto floats = task::matrixCast<float>(dynamic);
+        auto float_product = floats * task::matrixCast<float>(other);
+        auto narrowed = task::matrixCast<double>(float_product);
+        for (size_t i = 0; i < product.size().first; ++i) {
+            for (size_t j = 0; j < product.size().second; ++j) {
+                ASSERT_TRUE_MSG(fabs(narrowed[i][j] - product[i][j]) < 1e-2, "FloatMatrix product")
+            }
+        }
+
+        for (auto level : {task::SimdLevel::kScalar, task::SimdLevel::kSse2,
+                           task::SimdLevel::kAvx2, task::SimdLevel::kAvx512}) {
+            task::setSimdLevel(level);
+            auto sum = floats + floats, negated = -floats, scaled = floats * 0.5f;
+            for (size_t i = 0; i < floats.size().first; ++i) {
+                for (size_t j = 0; j < floats.size().second; ++j) {
+                    ASSERT_TRUE_MSG(sum[i][j] == floats[i][j] + floats[i][j], "FloatMatrix +")
+                    ASSERT_TRUE_MSG(negated[i][j] == -floats[i][j], "FloatMatrix unary -")
+                    ASSERT_TRUE_MSG(scaled[i][j] == floats[i][j] * 0.5f, "FloatMatrix scalar *")
+                }
+            }
+            ASSERT_TRUE_MSG(sum - floats == floats && sum != floats, "FloatMatrix == / !=")
+        }
+        ASSERT_EXCEPTION_MSG(task::FloatMatrix(2, 3) == task::FloatMatrix(3, 2), task::SizeMismatchException, "FloatMatrix ==")
+        task::setSimdLevel(task::detectedSimdLevel());
+
+        auto square = RandomMatrix(8, 8);
+        auto wide = task::matrixCast<long double>(square);
+        ASSERT_TRUE_MSG(fabs(static_cast<double>(wide.det()) - square.det()) <= fabs(square.det()) * 1e-9 + EPS, "LongDoubleMatrix det()")
+        ASSERT_TRUE_MSG(task::matrixCast<double>(wide.transposed()) == square.transposed(), "matrixCast to Matrix")
+
+        task::IntMatrix integers(4, 4);
+        int64_t values[4][4] = {{2, -1, 0, 7}, {3, 5, -2, 1}, {0, 4, 6, -3}, {1, 0, 2, 9}};
+        for (size_t i = 0; i < 4; ++i) {
+            std::copy_n(values[i], 4, integers[i]);
+        }
+        ASSERT_TRUE_MSG(integers.det() == 506, "IntMatrix det()")
+        ASSERT_TRUE_MSG(integers.trace() == 22, "IntMatrix trace()")
+        ASSERT_TRUE_MSG((integers * task::IntMatrix(4, 4)) == integers, "IntMatrix product")
+        ASSERT_TRUE_MSG((-integers)[3][3] == -9 && (-integers + integers) == task::IntMatrix(4, 4) * int64_t(0), "IntMatrix unary -")
+
+        task::IntMatrix large(3, 3);
+        large[0][0] = 2000000000;
+        large[1][1] = 2000000000;
+        large[2][2] = 2;
+        large[0][1] = 1;
+        large[1][0] = 1;
+        ASSERT_TRUE_MSG(large.det() == 7999999999999999998, "IntMatrix det() without overflow")
+
+        task::ComplexMatrix complex(2, 2);
+        complex[0][0] = {0., 1.};
+        complex[0][1] = {2., 0.};
+        complex[1][0] = {1., 0.};
+        complex[1][1] = {0., -1.};
+        ASSERT_TRUE_MSG(std::abs(complex.det() - std::complex<double>(-1., 0.)) < EPS, "ComplexMatrix det()")
+        ASSERT_TRUE_MSG(std::abs((complex * complex)[0][0] - std::complex<double>(1., 0.)) < EPS, "ComplexMatrix product")
+
+        std::stringstream stream;
+        stream << "2 3\n1 2 3\n4 5 6\n";
+        task::IntMatrix parsed;
+        stream >> parsed;
+        ASSERT_TRUE_MSG(parsed.size().first == 2 && parsed.size().second == 3 && parsed[1][2] == 6, "IntMatrix input")
+        std::vector<int64_t> column{2, 5};
+        ASSERT_TRUE_MSG(parsed.getColumn(1) == column, "IntMatrix getColumn()")
+
+        ASSERT_EXCEPTION_MSG(integers * parsed.transposed(), task::SizeMismatchException, "IntMatrix product")
+        ASSERT_EXCEPTION_MSG(parsed.get(2, 0), task::OutOfBoundsException, "IntMatrix get()")
+    }
+
+    {
+        auto sparse_dense = [](size_t rows, size_t cols) {
+            Matrix result = RandomMatrix(rows, cols);
+            for (size_t i = 0; i < rows; ++i) {
+                for (size_t j = 0; j < cols; ++j) {
+                    if (RandomUInt(9) != 0) {
+                        result[i][j] = 0.;
+                    }
+                }
+            }
+            return result;
+        };
+
+        auto dense = sparse_dense(RandomUInt(1, 60), RandomUInt(1, 60));
+        auto other = sparse_dense(dense.size().first, dense.size().second);
+        auto right = RandomMatrix(dense.size().second, RandomUInt(1, 30));
+        std::vector<double> x = right.getColumn(0);
+
+        for (auto format : {task::SparseFormat::kCsr, task::SparseFormat::kCsc}) {
+            task::SparseMatrix sparse(dense, format);
+            task::SparseMatrix sparse_other(other, TossCoin() ? task::SparseFormat::kCsr : task::SparseFormat::kCsc);
+
+            ASSERT_TRUE_MSG(sparse.format() == format && sparse.toDense() == dense, "Sparse from dense")
+            ASSERT_TRUE_MSG(sparse.toCsr().toDense() == dense && sparse.toCsc().toDense() == dense, "Sparse format conversion")
+            ASSERT_TRUE_MSG(sparse.density() == task::density(dense), "Sparse density()")
+            ASSERT_TRUE_MSG(sparse * right == dense * right, "Sparse * dense")
+
+            auto y = sparse * x, expected = (dense * right).getColumn(0);
+            for (size_t i = 0; i < y.size(); ++i) {
+                ASSERT_TRUE_MSG(fabs(y[i] - expected[i]) < EPS, "Sparse * vector")
+            }
+
+            ASSERT_TRUE_MSG((sparse + sparse_other).toDense() == dense + other, "Sparse +")
+            ASSERT_TRUE_MSG((sparse - sparse_other).toDense() == dense - other, "Sparse -")
+            ASSERT_TRUE_MSG((sparse - sparse).nonZeros() == 0, "Sparse - drops cancelled elements")
+            ASSERT_TRUE_MSG((2. * sparse).toDense() == dense * 2. && (-sparse).toDense() == -dense, "Sparse scalar * / unary -")
+            ASSERT_TRUE_MSG(sparse.transposed().toDense() == dense.transposed(), "Sparse transposed()")
+            ASSERT_TRUE_MSG(sparse.transposed().toCsr().toDense() == dense.transposed(), "Sparse transposed()")
+            ASSERT_TRUE_MSG(sparse == task::SparseMatrix(dense) && (dense == other || sparse != sparse_other), "Sparse ==")
+
+            size_t i = RandomUInt(dense.size().first - 1), j = RandomUInt(dense.size().second - 1);
+            ASSERT_TRUE_MSG(sparse.get(i, j) == dense[i][j], "Sparse get()")
+            ASSERT_EXCEPTION_MSG(sparse.get(dense.size().first, 0), task::OutOfBoundsException, "Sparse get()")
+            ASSERT_EXCEPTION_MSG(sparse * Matrix(dense.size().second + 1, 2), task::SizeMismatchException, "Sparse * dense")
+        }
+
+        auto triplets = task::SparseMatrix::fromTriplets(3, 4, {{2, 1, 1.}, {0, 3, 2.}, {2, 1, 3.}, {1, 0, -1.}, {0, 0, 5.}},
+                                                       task::SparseFormat::kCsc);
+        ASSERT_TRUE_MSG(triplets.nonZeros() == 4 && triplets.get(2, 1) == 4. && triplets.get(0, 0) == 5., "Sparse fromTriplets()")
+        ASSERT_TRUE_MSG(triplets.get(1, 1) == 0. && triplets.get(1, 0) == -1., "Sparse fromTriplets()")
+        ASSERT_EXCEPTION_MSG(task::SparseMatrix::fromTriplets(2, 2, {{2, 0, 1.}}), task::OutOfBoundsException, "Sparse fromTriplets()")
+
+        ASSERT_TRUE_MSG(task::isSparse(Matrix(100, 100)) && !task::isSparse(RandomMatrix(10, 10)), "isSparse()")
+        ASSERT_TRUE_MSG(task::SparseMatrix(Matrix(50, 50)).nonZeros() == 50, "Sparse identity")
+    }
+
+    {
+        CountingResource counting;
+        auto mat1 = RandomMatrix(RandomUInt(1, 100), RandomUInt(1, 100));
+        auto mat2 = RandomMatrix(mat1.size().first, mat1.size().second);
+        Matrix expected = mat1 + mat2 * 2.;
+
+        {
+            task::MatrixResourceScope scope(&counting);
+            ASSERT_TRUE_MSG(task::matrixResource() == &counting, "MatrixResourceScope")
+
+            Matrix copy = mat1;
+            Matrix sum = copy + mat2 * 2.;
+            Matrix square = copy * mat2.transposed();
+            copy.resize(copy.size().first + 1, 3);
+            copy.transpose();
+
+            ASSERT_TRUE_MSG(sum == expected && square == mat1 * mat2.transposed(), "Matrix on a memory resource")
+            ASSERT_TRUE_MSG(copy.memoryResource() == &counting && sum.memoryResource() == &counting, "Matrix memoryResource()")
+            ASSERT_TRUE_MSG(counting.allocations >= 5 && counting.live == 3, "Matrix allocations from the scope resource")
+        }
+        ASSERT_TRUE_MSG(counting.live == 0 && counting.aligned, "Matrix storage returned to its resource")
+        ASSERT_TRUE_MSG(task::matrixResource() == std::pmr::new_delete_resource(), "MatrixResourceScope restores")
+
+        Matrix outside(3, 3, &counting);
+        Matrix moved = std::move(outside);
+        Matrix copied = moved;
+        ASSERT_TRUE_MSG(moved.memoryResource() == &counting && copied.memoryResource() != &counting, "Matrix copy and move resources")
+        Matrix source = RandomMatrix(4, 5);
+        moved = source;
+        ASSERT_TRUE_MSG(moved.memoryResource() == &counting && counting.live == 1, "Matrix assignment keeps its resource")
+
+        std::pmr::monotonic_buffer_resource arena;
+        task::AllocatorResource<std::allocator<int>> adapted;
+        task::AllocatorResource<ChunkAllocator<char>> chunked{ChunkAllocator<char>(ChunkOptions{ 1 << 20 })};
+        for (std::pmr::memory_resource* resource : {static_cast<std::pmr::memory_resource*>(&arena),
+                                                    static_cast<std::pmr::memory_resource*>(&adapted),
+                                                    static_cast<std::pmr::memory_resource*>(&chunked)}) {
+            task::MatrixResourceScope scope(resource);
+            Matrix product = Matrix(mat1, resource) * mat2.transposed();
+            Matrix wide(3, 100);
+
+            ASSERT_TRUE_MSG(product == mat1 * mat2.transposed(), "Matrix on an arena")
+            ASSERT_TRUE_MSG(reinterpret_cast<uintptr_t>(wide.rawData()) % Matrix::kAlignment == 0, "Matrix alignment on an arena")
+        }
+    }
+
+    for (size_t n : {1, 2, 3, 4, 6}) {
+        size_t count = RandomUInt(1, 700);
+        std::vector<Matrix> lhs, rhs;
+        for (size_t index = 0; index < count; ++index) {
+            lhs.push_back(RandomMatrix(n, n));
+            rhs.push_back(RandomMatrix(n, n + 1));
+        }
+        lhs[count / 2] = Matrix(n, n) * 0.;
+
+        task::MatrixBatch batch(lhs), other(rhs);
+        ASSERT_TRUE_MSG(batch.count() == count && batch.stride() % 8 == 0, "MatrixBatch count() / stride()")
+
+        auto product = batch * other;
+        auto det = batch.det();
+        auto trace = batch.trace();
+        for (size_t index = 0; index < count; ++index) {
+            ASSERT_TRUE_MSG(batch.get(index) == lhs[index], "MatrixBatch get()")
+            ASSERT_TRUE_MSG(product.get(index) == lhs[index] * rhs[index], "MatrixBatch product")
+            ASSERT_TRUE_MSG(fabs(det[index] - lhs[index].det()) <= fabs(det[index]) * 1e-9 + EPS, "MatrixBatch det()")
+            ASSERT_TRUE_MSG(fabs(trace[index] - lhs[index].trace()) < EPS, "MatrixBatch trace()")
+        }
+
+        ASSERT_EXCEPTION_MSG(batch.inverse(), task::SingularMatrixException, "MatrixBatch inverse()")
+        batch.set(count / 2, Matrix(n, n));
+        auto inverse = batch.inverse();
+        auto identity = (batch * inverse).toMatrices();
+        for (size_t index = 0; index < count; ++index) {
+            ASSERT_TRUE_MSG(identity[index] == Matrix(n, n), "MatrixBatch inverse()")
+        }
+
+        ASSERT_EXCEPTION_MSG(other * other, task::SizeMismatchException, "MatrixBatch product")
+        ASSERT_EXCEPTION_MSG(other.det(), task::SizeMismatchException, "MatrixBatch det()")
+        ASSERT_EXCEPTION_MSG(batch.set(0, RandomMatrix(n + 1, n)), task::SizeMismatchException, "MatrixBatch set()")
+        ASSERT_EXCEPTION_MSG(batch.get(count), task::OutOfBoundsException, "MatrixBatch get()")
+    }
+
+    for (auto level : {task::SimdLevel::kScalar, task::SimdLevel::kSse2,
+                       task::SimdLevel::kAvx2, task::SimdLevel::kAvx512}) {
+        auto mat1 = RandomMatrix(RandomUInt(1, 20), RandomUInt(1, 100));
+        auto mat2 = RandomMatrix(mat1.size().first, mat1.size().second);
+        double scalar = RandomDouble();
+
+        task::setSimdLevel(task::SimdLevel::kScalar);
+        Matrix sum = mat1 + mat2, difference = mat1 - mat2, scaled = mat1 * scalar, negated = -mat1;
+
+        task::setSimdLevel(level);
+        for (size_t i = 0; i < mat1.size().first; ++i) {
+            for (size_t j = 0; j < mat1.size().second; ++j) {
+                ASSERT_TRUE_MSG(sum[i][j] == mat1[i][j] + mat2[i][j], "SIMD +")
+                ASSERT_TRUE_MSG(difference[i][j] == mat1[i][j] - mat2[i][j], "SIMD -")
+                ASSERT_TRUE_MSG(scaled[i][j] == mat1[i][j] * scalar, "SIMD scalar *")
+                ASSERT_TRUE_MSG(negated[i][j] == -mat1[i][j], "SIMD unary -")
+            }
+        }
+
+        ASSERT_TRUE_MSG(mat1 + mat2 == sum && mat1 - mat2 == difference, "SIMD + / -")
+        ASSERT_TRUE_MSG(mat1 * scalar == scaled && -mat1 == negated, "SIMD scalar * / unary -")
+
+        auto near = mat1;
+        near[mat1.size().first - 1][mat1.size().second - 1] += EPS * 2;
+        ASSERT_TRUE_MSG(mat1 != near, "SIMD == on the tail element")
+    }
+    task::setSimdLevel(task::detectedSimdLevel());
+
+    {
+        task::ThreadPool::instance().setThreadCount(4);
+
+        auto mat1 = RandomMatrix(RandomUInt(300, 400), RandomUInt(100, 200));
+        auto mat2 = RandomMatrix(mat1.size().second, RandomUInt(100, 200));
+        auto mat3 = RandomMatrix(mat1.size().first, mat1.size().second);
+        Matrix square = RandomMatrix(300, 300) * 0.1;
+
+        auto product = mat1 * mat2;
+        Matrix sum = mat1 + mat3;
+        auto transposed = mat1.transposed();
+        double det = square.det();
+
+        ASSERT_TRUE_MSG(Matrix::multiply(mat1, mat2, task::ExecutionPolicy::kParallel) == product,
+                        "Parallel multiplication")
+
+        task::setDefaultExecutionPolicy(task::ExecutionPolicy::kParallel);
+
+        ASSERT_TRUE_MSG(mat1 * mat2 == product, "Parallel multiplication")
+        ASSERT_TRUE_MSG(mat1 + mat3 == sum, "Parallel +")
+        ASSERT_TRUE_MSG(mat1.transposed() == transposed, "Parallel transposed()")
+        ASSERT_TRUE_MSG(fabs(square.det() - det) <= fabs(det) * 1e-9, "Parallel det()")
+
+        std::vector<size_t> hits(10000);
+        task::ThreadPool::instance().parallelFor(0, hits.size(), 16, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                ++hits[i];
+            }
+        });
+        ASSERT_TRUE_MSG(std::count(hits.begin(), hits.end(), 1) == 10000, "parallelFor covers the range once")
+
+        task::setDefaultExecutionPolicy(task::ExecutionPolicy::kSequential);
+    }
+
     REPEAT(10)
     {
         size_t n = RandomUInt(1, 200);